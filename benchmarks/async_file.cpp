@@ -0,0 +1,120 @@
+/**
+ * Cost of writing log records to a file on the producing thread:
+ *   - write() per record, as the FileAppender of logger_write_to_file
+ *   - logger::AsyncFile with the pwrite backend
+ *   - logger::AsyncFile with the io_uring backend
+ * For AsyncFile, records are written in bursts the writer thread can keep up with; the time until
+ * all of them are on file is reported as well.
+ *
+ * Usage: async_file [records] [directory]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "logger/async_file.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result
+{
+	/// mean and maximum time spent by the producer per record
+	double mean_us;
+	double max_us;
+	/// time until all records are written
+	double total_ms;
+	uint64_t dropped;
+};
+
+template <typename Write, typename Flush>
+Result measure(std::vector<std::string> const& records, Write&& write, Flush&& flush)
+{
+	Result result = {0, 0, 0, 0};
+	auto const start = Clock::now();
+	for (size_t i = 0; i < records.size(); ++i) {
+		auto const before = Clock::now();
+		write(records[i]);
+		std::chrono::duration<double, std::micro> const elapsed = Clock::now() - before;
+		result.mean_us += elapsed.count();
+		result.max_us = std::max(result.max_us, elapsed.count());
+		if (i % 256 == 255) {
+			// bursts as produced by a busy application, excluded from the producer time
+			flush();
+		}
+	}
+	flush();
+	std::chrono::duration<double, std::milli> const total = Clock::now() - start;
+	result.mean_us /= static_cast<double>(records.size());
+	result.total_ms = total.count();
+	return result;
+}
+
+void print(char const* name, Result const& result)
+{
+	printf(
+	    "%-16s %8.3f us/record  max %9.1f us  total %8.1f ms  dropped %lu\n", name, result.mean_us,
+	    result.max_us, result.total_ms, static_cast<unsigned long>(result.dropped));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t const count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+	std::string const directory = (argc > 2) ? argv[2] : "/tmp";
+	std::string const filename = directory + "/logger_async_file_" + std::to_string(getpid());
+
+	std::vector<std::string> records;
+	for (size_t i = 0; i < count; ++i) {
+		records.push_back(
+		    "INFO  2024-01-01 12:00:00,000  hal.benchmark record " + std::to_string(i) +
+		    " with a typical amount of payload\n");
+	}
+
+	{
+		int const fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			perror("open");
+			return EXIT_FAILURE;
+		}
+		Result const result = measure(
+		    records,
+		    [fd](std::string const& record) {
+			    if (write(fd, record.data(), record.size()) < 0) {
+				    perror("write");
+			    }
+		    },
+		    [] {});
+		close(fd);
+		print("write()", result);
+	}
+
+	using Backend = logger::AsyncFile::Backend;
+	for (Backend backend : {Backend::pwrite, Backend::io_uring}) {
+		char const* name = (backend == Backend::pwrite) ? "AsyncFile pwrite" : "AsyncFile uring";
+		try {
+			logger::AsyncFile file(filename, false, backend);
+			Result result = measure(
+			    records,
+			    [&file](std::string const& record) { file.write(record.data(), record.size()); },
+			    [&file] { file.flush(); });
+			result.dropped = file.dropped();
+			print(name, result);
+		} catch (std::system_error const& error) {
+			printf("%-16s unavailable: %s\n", name, error.what());
+		}
+	}
+
+	std::remove(filename.c_str());
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/**
+ * Startup cost of the logger configuration, as paid by every process of a job:
+ *   - locating the configuration file per call vs. logger_config_path()
+ *   - PropertyConfigurator vs. a compiled configuration (see CompiledConfig)
+ *
+ * Usage: startup [iterations]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+#include <log4cxx/basicconfigurator.h>
+#include <log4cxx/propertyconfigurator.h>
+
+#include <boost/filesystem.hpp>
+
+#include "logger/log4cxx/compiled_config.h"
+#include "logger/log4cxx/logger.h"
+#include "logger/log4cxx/logging_ctrl.h"
+
+namespace {
+
+template <typename F>
+double measure_us(size_t iterations, F&& f)
+{
+	auto const start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; ++i) {
+		f();
+	}
+	std::chrono::duration<double, std::micro> const elapsed =
+	    std::chrono::steady_clock::now() - start;
+	return elapsed.count() / static_cast<double>(iterations);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	size_t const iterations = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000;
+
+	char dir[] = "/tmp/logger_startup_XXXXXX";
+	if (!mkdtemp(dir)) {
+		perror("mkdtemp");
+		return EXIT_FAILURE;
+	}
+	std::string const conf = std::string(dir) + "/symap2ic_logger.conf";
+	std::string const compiled = conf + ".bin";
+	{
+		std::ofstream file(conf);
+		file << "log4j.rootLogger=INFO, FILE\n"
+		     << "log4j.logger.hal=DEBUG\n"
+		     << "log4j.logger.stadls.fisch=TRACE, FILE\n"
+		     << "log4j.additivity.stadls.fisch=false\n"
+		     << "log4j.appender.FILE=org.apache.log4j.FileAppender\n"
+		     << "log4j.appender.FILE.File=/dev/null\n"
+		     << "log4j.appender.FILE.layout=org.apache.log4j.PatternLayout\n"
+		     << "log4j.appender.FILE.layout.ConversionPattern=%-5p %d{ISO8601}  %c %m%n\n";
+	}
+	logger_compile_config(conf, compiled);
+	if (chdir(dir) != 0) {
+		perror("chdir");
+		return EXIT_FAILURE;
+	}
+
+	double const lookup = measure_us(iterations, [] {
+		boost::filesystem::path logger_config("symap2ic_logger.conf");
+		if (boost::filesystem::exists(logger_config)) {
+			boost::filesystem::system_complete(logger_config);
+		}
+	});
+	double const cached_lookup = measure_us(iterations, [] { logger_config_path(); });
+
+	double const properties = measure_us(iterations, [&conf] {
+		log4cxx::BasicConfigurator::resetConfiguration();
+		log4cxx::PropertyConfigurator::configure(conf);
+	});
+	visionary_logger::CompiledConfig const config =
+	    visionary_logger::CompiledConfig::load(compiled);
+	double const apply = measure_us(iterations, [&config] {
+		log4cxx::BasicConfigurator::resetConfiguration();
+		config.apply();
+	});
+	double const load_apply = measure_us(iterations, [&compiled] {
+		log4cxx::BasicConfigurator::resetConfiguration();
+		visionary_logger::CompiledConfig::load(compiled).apply();
+	});
+
+	printf("config lookup per call:     %8.2f us\n", lookup);
+	printf("logger_config_path():       %8.2f us\n", cached_lookup);
+	printf("PropertyConfigurator:       %8.2f us\n", properties);
+	printf("CompiledConfig::apply:      %8.2f us\n", apply);
+	printf("load + apply (per process): %8.2f us\n", load_apply);
+
+	log4cxx::BasicConfigurator::resetConfiguration();
+	std::remove(compiled.c_str());
+	std::remove(conf.c_str());
+	rmdir(dir);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,589 @@
+#pragma once
+
+/**
+ * @file async_file.h
+ *
+ * File written by a background thread, so that producers never wait for the file system, e.g. a
+ * stalling NFS or Lustre mount (see log4cxx::AsyncFileAppender).
+ *
+ * Records are copied into one of a few fixed buffers. Full buffers, and partially filled ones
+ * after at most a few milliseconds, are written by the writer thread as one batch: through
+ * io_uring with buffers registered once, or with pwritev() where io_uring is not available
+ * (kernel before 5.1, disabled by sysctl or seccomp, RLIMIT_MEMLOCK too small for the buffers).
+ * io_uring is driven by raw system calls, liburing is not required.
+ *
+ * If all buffers are waiting to be written, records are dropped and counted instead of blocking
+ * the producer. The file is written at explicit offsets starting at its size when opened, it must
+ * not be written by others at the same time.
+ */
+
+extern "C" {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define LOGGER_HAVE_IO_URING 1
+#else
+#define LOGGER_HAVE_IO_URING 0
+#endif
+
+namespace logger {
+
+namespace detail {
+
+#if LOGGER_HAVE_IO_URING
+
+/**
+ * Minimal io_uring instance writing registered buffers to one file, used by the writer thread
+ * only.
+ */
+class UringFile
+{
+public:
+	/**
+	 * @param buffers Buffers registered for IORING_OP_WRITE_FIXED, at most one write per buffer
+	 *                is in flight.
+	 * @throws std::system_error if io_uring is not available
+	 */
+	UringFile(int fd, std::vector<iovec> const& buffers) :
+	    m_fd(fd),
+	    m_ring(-1),
+	    m_sq_ring(MAP_FAILED),
+	    m_cq_ring(MAP_FAILED),
+	    m_sqes(MAP_FAILED),
+	    m_sq_ring_size(0),
+	    m_cq_ring_size(0),
+	    m_sqes_size(0)
+	{
+		io_uring_params params;
+		std::memset(&params, 0, sizeof(params));
+		m_ring = static_cast<int>(
+		    syscall(__NR_io_uring_setup, static_cast<unsigned>(buffers.size()), &params));
+		if (m_ring < 0) {
+			throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+		}
+
+		m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool const single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+		if (single_mmap) {
+			m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+		}
+		m_sq_ring = map(m_sq_ring_size, IORING_OFF_SQ_RING);
+		m_cq_ring = single_mmap ? m_sq_ring : map(m_cq_ring_size, IORING_OFF_CQ_RING);
+		m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		m_sqes = map(m_sqes_size, IORING_OFF_SQES);
+
+		char* sq = static_cast<char*>(m_sq_ring);
+		m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+		m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+		m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+		char* cq = static_cast<char*>(m_cq_ring);
+		m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+		m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+		m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+		m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+		if (syscall(
+		        __NR_io_uring_register, m_ring, IORING_REGISTER_BUFFERS, buffers.data(),
+		        static_cast<unsigned>(buffers.size())) != 0) {
+			int const error = errno;
+			release();
+			throw std::system_error(error, std::generic_category(), "io_uring_register");
+		}
+	}
+
+	~UringFile()
+	{
+		release();
+	}
+
+	UringFile(UringFile const&) = delete;
+	UringFile& operator=(UringFile const&) = delete;
+
+	struct Write
+	{
+		unsigned buffer;
+		char const* data;
+		size_t size;
+		off_t offset;
+		/// bytes written or negative errno, set by write()
+		ssize_t result;
+	};
+
+	/**
+	 * Submit all writes at once and wait for their completion.
+	 * @return false if io_uring failed as a whole, results are then invalid
+	 */
+	bool write(std::vector<Write>& writes)
+	{
+		unsigned tail = *m_sq_tail;
+		for (size_t i = 0; i < writes.size(); ++i) {
+			unsigned const index = tail & m_sq_mask;
+			io_uring_sqe& sqe = static_cast<io_uring_sqe*>(m_sqes)[index];
+			std::memset(&sqe, 0, sizeof(sqe));
+			sqe.opcode = IORING_OP_WRITE_FIXED;
+			sqe.fd = m_fd;
+			sqe.addr = reinterpret_cast<uintptr_t>(writes[i].data);
+			sqe.len = static_cast<uint32_t>(writes[i].size);
+			sqe.off = static_cast<uint64_t>(writes[i].offset);
+			sqe.buf_index = static_cast<uint16_t>(writes[i].buffer);
+			sqe.user_data = i;
+			m_sq_array[index] = index;
+			++tail;
+		}
+		__atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+
+		unsigned const count = static_cast<unsigned>(writes.size());
+		unsigned submitted = 0;
+		unsigned completed = 0;
+		while (completed < count) {
+			long const result = syscall(
+			    __NR_io_uring_enter, m_ring, count - submitted, 1, IORING_ENTER_GETEVENTS,
+			    nullptr, 0);
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return false;
+			}
+			submitted += static_cast<unsigned>(result);
+
+			unsigned head = *m_cq_head;
+			unsigned const cq_tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+			for (; head != cq_tail; ++head, ++completed) {
+				io_uring_cqe const& cqe = m_cqes[head & m_cq_mask];
+				writes[cqe.user_data].result = cqe.res;
+			}
+			__atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+		}
+		return true;
+	}
+
+private:
+	void* map(size_t size, off_t offset)
+	{
+		void* memory =
+		    mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, offset);
+		if (memory == MAP_FAILED) {
+			int const error = errno;
+			release();
+			throw std::system_error(error, std::generic_category(), "mmap io_uring");
+		}
+		return memory;
+	}
+
+	void release()
+	{
+		if (m_sqes != MAP_FAILED) {
+			munmap(m_sqes, m_sqes_size);
+			m_sqes = MAP_FAILED;
+		}
+		if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) {
+			munmap(m_cq_ring, m_cq_ring_size);
+		}
+		m_cq_ring = MAP_FAILED;
+		if (m_sq_ring != MAP_FAILED) {
+			munmap(m_sq_ring, m_sq_ring_size);
+			m_sq_ring = MAP_FAILED;
+		}
+		if (m_ring >= 0) {
+			::close(m_ring);
+			m_ring = -1;
+		}
+	}
+
+	int m_fd;
+	int m_ring;
+	void* m_sq_ring;
+	void* m_cq_ring;
+	void* m_sqes;
+	size_t m_sq_ring_size;
+	size_t m_cq_ring_size;
+	size_t m_sqes_size;
+	unsigned* m_sq_tail;
+	unsigned m_sq_mask;
+	unsigned* m_sq_array;
+	unsigned* m_cq_head;
+	unsigned* m_cq_tail;
+	unsigned m_cq_mask;
+	io_uring_cqe* m_cqes;
+};
+
+#endif // LOGGER_HAVE_IO_URING
+
+} // namespace detail
+
+/**
+ * File written by a background thread, records are written in the order of write() calls.
+ */
+class AsyncFile
+{
+public:
+	enum class Backend
+	{
+		/// io_uring if available, pwrite otherwise
+		automatic,
+		io_uring,
+		pwrite
+	};
+
+	/**
+	 * Open the file and start the writer thread.
+	 * @param buffers Number of buffers of buffer_size bytes, records longer than a buffer are
+	 *                truncated.
+	 * @param latency Time after which a partially filled buffer is written.
+	 * @throws std::system_error if the file cannot be opened, or io_uring is requested but not
+	 *                           available
+	 */
+	AsyncFile(
+	    std::string const& filename,
+	    bool append = true,
+	    Backend backend = Backend::automatic,
+	    size_t buffer_size = 64 * 1024,
+	    size_t buffers = 4,
+	    std::chrono::milliseconds latency = std::chrono::milliseconds(10)) :
+	    m_fd(-1),
+	    m_backend(Backend::pwrite),
+	    m_buffer_size(buffer_size),
+	    m_latency(latency),
+	    m_current(none),
+	    m_sealed(0),
+	    m_written(0),
+	    m_stop(false),
+	    m_offset(0),
+	    m_dropped(0),
+	    m_error(0)
+	{
+		// page-aligned, as preferred for registered buffers
+		size_t const page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		size_t const capacity = (buffer_size + page - 1) / page * page;
+		std::vector<iovec> registered;
+		for (size_t i = 0; i < std::max<size_t>(buffers, 2); ++i) {
+			char* data = static_cast<char*>(std::aligned_alloc(page, capacity));
+			if (!data) {
+				throw std::bad_alloc();
+			}
+			m_buffers.push_back(Buffer{std::unique_ptr<char, Free>(data), 0});
+			m_free.push_back(i);
+			registered.push_back(iovec{data, capacity});
+		}
+
+		m_fd = ::open(
+		    filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC), 0644);
+		if (m_fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "open " + filename);
+		}
+		struct stat st;
+		if (fstat(m_fd, &st) == 0) {
+			m_offset = st.st_size;
+		}
+
+#if LOGGER_HAVE_IO_URING
+		if (backend != Backend::pwrite) {
+			try {
+				m_uring.reset(new detail::UringFile(m_fd, registered));
+				m_backend.store(Backend::io_uring, std::memory_order_relaxed);
+			} catch (std::system_error const&) {
+				if (backend == Backend::io_uring) {
+					::close(m_fd);
+					throw;
+				}
+			}
+		}
+#else
+		if (backend == Backend::io_uring) {
+			::close(m_fd);
+			throw std::system_error(ENOSYS, std::generic_category(), "io_uring");
+		}
+#endif
+
+		m_thread = std::thread([this] { run(); });
+	}
+
+	~AsyncFile()
+	{
+		close();
+	}
+
+	AsyncFile(AsyncFile const&) = delete;
+	AsyncFile& operator=(AsyncFile const&) = delete;
+
+	/**
+	 * Queue a record without waiting for the file system.
+	 * @return false if the record was dropped because all buffers are waiting to be written or
+	 * the file is closing
+	 */
+	bool write(char const* data, size_t size)
+	{
+		size = std::min(size, m_buffer_size);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_stop) {
+			// the writer thread may already have taken its last batch
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		if (m_current != none && m_buffers[m_current].size + size > m_buffer_size) {
+			seal();
+			m_wakeup.notify_one();
+		}
+		if (m_current == none) {
+			if (m_free.empty()) {
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			m_current = m_free.back();
+			m_free.pop_back();
+		}
+		Buffer& buffer = m_buffers[m_current];
+		std::memcpy(buffer.data.get() + buffer.size, data, size);
+		if (buffer.size == 0) {
+			// starts the latency timer of the writer thread
+			m_wakeup.notify_one();
+		}
+		buffer.size += size;
+		return true;
+	}
+
+	/**
+	 * Wait until all records queued so far are written.
+	 */
+	void flush()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		seal();
+		uint64_t const target = m_sealed;
+		m_wakeup.notify_one();
+		m_done.wait(lock, [&] { return m_written >= target; });
+	}
+
+	/**
+	 * Write all queued records, stop the writer thread and close the file.
+	 */
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_thread.joinable()) {
+				return;
+			}
+			m_stop = true;
+		}
+		m_wakeup.notify_one();
+		m_thread.join();
+		m_done.notify_all();
+#if LOGGER_HAVE_IO_URING
+		m_uring.reset();
+#endif
+		::close(m_fd);
+	}
+
+	/// backend in use, never automatic
+	Backend backend() const
+	{
+		return m_backend.load(std::memory_order_relaxed);
+	}
+
+	/// number of records dropped because all buffers were waiting to be written or the file
+	/// was closing
+	uint64_t dropped() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+
+	/// errno of the last failed write, 0 if all writes succeeded
+	int error() const
+	{
+		return m_error.load(std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr size_t none = SIZE_MAX;
+
+	struct Free
+	{
+		void operator()(char* data) const
+		{
+			std::free(data);
+		}
+	};
+
+	struct Buffer
+	{
+		std::unique_ptr<char, Free> data;
+		size_t size;
+	};
+
+	/// queue the current buffer for writing, called with the lock held
+	void seal()
+	{
+		if (m_current != none && m_buffers[m_current].size != 0) {
+			m_full.push_back(m_current);
+			m_current = none;
+			++m_sealed;
+		}
+	}
+
+	/**
+	 * Writer thread: write queued buffers in batches until stopped and all buffers are written.
+	 */
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (true) {
+			if (m_full.empty()) {
+				if (m_stop) {
+					seal();
+					if (m_full.empty()) {
+						return;
+					}
+				} else if (m_current == none || m_buffers[m_current].size == 0) {
+					m_wakeup.wait(lock, [&] {
+						return !m_full.empty() || m_stop ||
+						       (m_current != none && m_buffers[m_current].size != 0);
+					});
+				} else {
+					if (!m_wakeup.wait_for(
+					        lock, m_latency, [&] { return !m_full.empty() || m_stop; })) {
+						seal();
+					}
+				}
+				continue;
+			}
+
+			std::vector<size_t> batch(m_full.begin(), m_full.end());
+			m_full.clear();
+			lock.unlock();
+			write_batch(batch);
+			lock.lock();
+			for (size_t index : batch) {
+				m_buffers[index].size = 0;
+				m_free.push_back(index);
+			}
+			m_written += batch.size();
+			m_done.notify_all();
+		}
+	}
+
+	void write_batch(std::vector<size_t> const& batch)
+	{
+		std::vector<iovec> pieces;
+		for (size_t index : batch) {
+			pieces.push_back(iovec{m_buffers[index].data.get(), m_buffers[index].size});
+		}
+
+#if LOGGER_HAVE_IO_URING
+		if (m_uring) {
+			std::vector<detail::UringFile::Write> writes;
+			off_t offset = m_offset;
+			for (size_t i = 0; i < batch.size(); ++i) {
+				writes.push_back(detail::UringFile::Write{
+				    static_cast<unsigned>(batch[i]), static_cast<char const*>(pieces[i].iov_base),
+				    pieces[i].iov_len, offset, 0});
+				offset += static_cast<off_t>(pieces[i].iov_len);
+			}
+			if (m_uring->write(writes)) {
+				// short or failed writes are completed synchronously
+				for (auto const& write : writes) {
+					size_t const done = write.result > 0 ? static_cast<size_t>(write.result) : 0;
+					write_all(write.data + done, write.size - done, write.offset + done);
+				}
+				m_offset = offset;
+				return;
+			}
+			// the ring is unusable, e.g. interrupted submission state; continue without it
+			m_error.store(errno, std::memory_order_relaxed);
+			m_uring.reset();
+			m_backend.store(Backend::pwrite, std::memory_order_relaxed);
+		}
+#endif
+
+		size_t total = 0;
+		for (iovec const& piece : pieces) {
+			total += piece.iov_len;
+		}
+		ssize_t result;
+		do {
+			result = pwritev(m_fd, pieces.data(), static_cast<int>(pieces.size()), m_offset);
+		} while (result < 0 && errno == EINTR);
+		size_t done = result > 0 ? static_cast<size_t>(result) : 0;
+		off_t offset = m_offset;
+		for (iovec const& piece : pieces) {
+			size_t const skip = std::min(done, piece.iov_len);
+			write_all(
+			    static_cast<char const*>(piece.iov_base) + skip, piece.iov_len - skip,
+			    offset + static_cast<off_t>(skip));
+			done -= skip;
+			offset += static_cast<off_t>(piece.iov_len);
+		}
+		m_offset += static_cast<off_t>(total);
+	}
+
+	void write_all(char const* data, size_t size, off_t offset)
+	{
+		while (size != 0) {
+			ssize_t const result = pwrite(m_fd, data, size, offset);
+			if (result < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				m_error.store(errno, std::memory_order_relaxed);
+				return;
+			}
+			data += result;
+			size -= static_cast<size_t>(result);
+			offset += result;
+		}
+	}
+
+	int m_fd;
+	std::atomic<Backend> m_backend;
+	size_t const m_buffer_size;
+	std::chrono::milliseconds const m_latency;
+#if LOGGER_HAVE_IO_URING
+	std::unique_ptr<detail::UringFile> m_uring;
+#endif
+
+	// buffer states, guarded by m_mutex
+	std::mutex m_mutex;
+	std::vector<Buffer> m_buffers;
+	std::vector<size_t> m_free;
+	std::deque<size_t> m_full;
+	size_t m_current;
+	uint64_t m_sealed;
+	uint64_t m_written;
+	bool m_stop;
+	std::condition_variable m_wakeup;
+	std::condition_variable m_done;
+	std::thread m_thread;
+
+	/// next file offset, used by the writer thread only
+	off_t m_offset;
+	std::atomic<uint64_t> m_dropped;
+	std::atomic<int> m_error;
+};
+
+} // namespace logger
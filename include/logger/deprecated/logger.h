@@ -13,6 +13,11 @@
 #ifndef __LOGGER_H__
 #define __LOGGER_H__
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -22,6 +27,7 @@
 #ifndef PYPLUSPLUS
 	#include <boost/thread/thread.hpp>
 	#include <boost/thread/mutex.hpp>
+	#include <boost/thread/condition_variable.hpp>
 	#include <boost/thread/tss.hpp>
 #endif
 
@@ -103,6 +109,144 @@ public:
 	void setstate(std::ios_base::iostate state);
 	std::streamsize width (std::streamsize wide);
 	std::string str();
+
+	//! Empty the stream for the next line, keeping the allocated buffer
+	void reset();
+
+	friend class Logger;
+	friend class LogLine;
+};
+
+
+
+//! Handle of one log line
+/*! Returned by Logger::line(). The line is written when the handle is destroyed, e.g. at the end
+  of the statement for
+      log.line(Logger::INFO) << "value: " << value;
+  or at the end of the scope for a named handle. Handles are move-only; their streams are taken
+  from and returned to a per-thread pool, so logging allocates no streams once the pool is warm.
+  Handles of suppressed levels hold no stream and ignore all stream-ins. */
+class LogLine
+{
+public:
+	LogLine() : stream(NULL) {}
+	~LogLine();
+
+	LogLine(LogLine&& other) : stream(other.stream)
+	{
+		other.stream = NULL;
+	}
+
+	LogLine& operator=(LogLine&& other);
+
+	LogLine(LogLine const&) = delete;
+	LogLine& operator=(LogLine const&) = delete;
+
+	template <typename T>
+	LogLine& operator<<(const T& val)
+	{
+		if (stream) *stream << val;
+		return *this;
+	}
+
+	//! Catches std::ostream format stream manipulators
+	LogLine& operator<<(std::ostream& (*manip)(std::ostream&))
+	{
+		if (stream) *stream << manip;
+		return *this;
+	}
+
+	//! Whether the line will be written
+	explicit operator bool() const
+	{
+		return stream != NULL;
+	}
+
+private:
+	explicit LogLine(LogStream* s) : stream(s) {}
+
+	//! Take a reset stream from the calling thread's pool
+	static LogStream* acquire();
+	//! Write out the stream and return it to the calling thread's pool
+	static void release(LogStream* stream);
+
+	LogStream* stream;
+
+	friend class Logger;
+};
+
+
+
+//! Timestamps of log lines
+/*! Formats the wall-clock time as before ("2010-Mar-01 12:00:00.123456") without iostreams or
+  locales: the date and seconds are formatted once per second and thread, the microseconds are
+  appended as integer. Alternatively, the monotonic time since the creation of the Logger is
+  written ("+12.345678"), which is immune to clock adjustments. */
+class LogTimestamp
+{
+public:
+	enum Mode {LOCAL_TIME=0, MONOTONIC=1};
+
+	//! buffer size required by format()
+	static size_t const size = 32;
+
+	static void setMode(Mode mode);
+	static Mode getMode();
+
+	//! Writes the null-terminated current timestamp to buffer, which must hold size bytes
+	static char const* format(char* buffer);
+
+	//! Reference of monotonic timestamps, fixed by the first call
+	static std::chrono::steady_clock::time_point start();
+
+private:
+	static std::atomic<int>& mode();
+	//! appends the digits of value, zero-padded to width
+	static char* appendDigits(char* out, unsigned long long value, int width);
+};
+
+
+
+//! Single writer of completed lines
+/*! Completed lines of all threads are pushed onto a lock-free list and written by one writer
+  thread in batches, so lines never interleave and logging threads never wait for I/O. The output
+  is flushed once per batch instead of once per line. There is no need to use this class stand
+  alone. */
+class LogWriter
+{
+public:
+	static LogWriter& instance();
+
+	//! Queue a completed line (including its newline) for output
+	void push(std::string const& line);
+
+	//! Write all queued lines and stop the writer thread, later lines are written synchronously
+	void stop();
+
+private:
+	struct Line
+	{
+		Line* next;
+		std::string text;
+	};
+
+	LogWriter();
+
+	//! writer thread: wait for lines and write them
+	void run();
+	//! write lines taken from the list, newest first, in order of pushing
+	void write(Line* lines);
+
+	std::atomic<Line*> lines;
+	std::atomic<bool> running;
+	std::atomic<bool> sleeping;
+#ifndef PYPLUSPLUS
+	//! guards starting and stopping the writer thread and serializes writes after stop()
+	boost::mutex thread_mutex;
+	boost::mutex wakeup_mutex;
+	boost::condition_variable wakeup;
+	boost::thread thread;
+#endif // PYPLUSPLUS
 };
 
 
@@ -148,6 +292,9 @@ public:
 	//! Get stream instance
 	LogStream& operator() (size_t level=DEFAULT_LOG_LEVEL);
 
+	//! Get a handle of a new line, written when the handle is destroyed, see LogLine
+	LogLine line(size_t level=DEFAULT_LOG_LEVEL);
+
 	//! Stream operator for data in multi-line comments
 	template <typename T>
 	LogStream& operator<<(const T& val);
@@ -202,7 +349,8 @@ private:
 	const char* resetColor() const;
 #endif // LOG_COLOR_OUTPUT
 
-	LogStream& formatStream(size_t level);
+	//! Writes the timestamp and level tag to stream
+	LogStream& formatStream(LogStream& stream, size_t level);
 	//! Contains the criticality tags for stream formatting
 	static char const * const * getBuffer();
 
@@ -213,6 +361,7 @@ private:
 
 	//! provide private interface for LogStream class
 	friend class LogStream;
+	friend class LogWriter;
 	friend class Logger::AlterLevel;
 
 	template<typename T>
@@ -242,8 +391,9 @@ inline boost::scoped_ptr<Logger>& Logger::_getInstance() {
 }
 
 inline std::ofstream& Logger::getLogfile() {
-	static std::ofstream logfile;
-	return logfile;
+	// leaked on purpose, closed by ~Logger after the last line was written
+	static std::ofstream* logfile = new std::ofstream;
+	return *logfile;
 }
 
 inline bool& Logger::getLogdual() {
@@ -276,10 +426,9 @@ inline void LogStream::writeOut()
 {
 	if (!local_stream.bad())
 	{
-		local_stream << std::endl;
-		getOutStream() << local_stream.str();
-		if (Logger::getLogdual())
-			std::cout << local_stream.str();
+		// no flush, the writer flushes once per batch
+		local_stream << '\n';
+		LogWriter::instance().push(local_stream.str());
 	}
 }
 
@@ -290,25 +439,106 @@ inline LogStream& LogStream::flush(LogStream& stream)
 	return stream;
 }
 
-inline LogStream& Logger::formatStream(size_t level)
+inline std::atomic<int>& LogTimestamp::mode()
 {
-	using boost::posix_time::microsec_clock;
-#ifndef PYPLUSPLUS
+	static std::atomic<int> timestamp_mode(LOCAL_TIME);
+	return timestamp_mode;
+}
+
+inline void LogTimestamp::setMode(Mode m)
+{
+	mode().store(m, std::memory_order_relaxed);
+}
+
+inline LogTimestamp::Mode LogTimestamp::getMode()
+{
+	return static_cast<Mode>(mode().load(std::memory_order_relaxed));
+}
+
+inline std::chrono::steady_clock::time_point LogTimestamp::start()
+{
+	static std::chrono::steady_clock::time_point const start_time =
+		std::chrono::steady_clock::now();
+	return start_time;
+}
+
+inline char* LogTimestamp::appendDigits(char* out, unsigned long long value, int width)
+{
+	char digits[20];
+	int n = 0;
+	do {
+		digits[n++] = static_cast<char>('0' + value % 10);
+		value /= 10;
+	} while (value > 0);
+	while (n < width)
+		digits[n++] = '0';
+	while (n > 0)
+		*out++ = digits[--n];
+	return out;
+}
+
+inline char const* LogTimestamp::format(char* buffer)
+{
+	char* out = buffer;
+	if (getMode() == MONOTONIC)
+	{
+		unsigned long long const us = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start()).count();
+		*out++ = '+';
+		out = appendDigits(out, us / 1000000, 1);
+		*out++ = '.';
+		out = appendDigits(out, us % 1000000, 6);
+		*out = '\0';
+		return buffer;
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+
+	// date and time up to the seconds, formatted once per second
+	struct Prefix
+	{
+		time_t second;
+		size_t length;
+		char text[size];
+	};
+	static thread_local Prefix prefix = {-1, 0, {}};
+	if (prefix.second != now.tv_sec)
+	{
+		static char const* const months[] = {
+			"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+			"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+		};
+		struct tm local;
+		localtime_r(&now.tv_sec, &local);
+		int const length = snprintf(prefix.text, sizeof(prefix.text),
+			"%04d-%s-%02d %02d:%02d:%02d.", local.tm_year + 1900, months[local.tm_mon],
+			local.tm_mday, local.tm_hour, local.tm_min, local.tm_sec);
+		prefix.length = (length > 0) ? static_cast<size_t>(length) : 0;
+		prefix.second = now.tv_sec;
+	}
+	std::memcpy(out, prefix.text, prefix.length);
+	out = appendDigits(out + prefix.length, static_cast<unsigned long long>(now.tv_nsec / 1000), 6);
+	*out = '\0';
+	return buffer;
+}
+
+inline LogStream& Logger::formatStream(LogStream& stream, size_t level)
+{
+	char timestamp[LogTimestamp::size];
 #ifdef LOG_COLOR_OUTPUT
-	*local_stream << COLOR_RESET;
-	*local_stream << microsec_clock::local_time() << " ";
-	*local_stream << toColor(level);
-	local_stream->width(10);
-	*local_stream << std::left << buffer[level];
-	*local_stream << resetColor() << ": ";
+	stream << COLOR_RESET;
+	stream << LogTimestamp::format(timestamp) << " ";
+	stream << toColor(level);
+	stream.width(10);
+	stream << std::left << getBuffer()[level];
+	stream << resetColor() << ": ";
 #else // LOG_COLOR_OUTPUT
-	*local_stream  << microsec_clock::local_time() << " ";
-	local_stream->width(10);
-	*local_stream << std::left << getBuffer()[level] << ": ";
+	stream << LogTimestamp::format(timestamp) << " ";
+	stream.width(10);
+	stream << std::left << getBuffer()[level] << ": ";
 #endif // LOG_COLOR_OUTPUT
-
-	return *local_stream;
-#endif // PYPLUSPLUS
+	return stream;
 }
 
 inline void Logger::resetStream(LogStream* stream)
@@ -320,8 +550,29 @@ inline void Logger::resetStream(LogStream* stream)
 
 inline LogStream& Logger::resetStreamLevel(size_t level)
 {
-	resetStream(new LogStream);
-	return formatStream(level);
+#ifndef PYPLUSPLUS
+	// reuse the thread's stream and its buffer for the next line
+	if (local_stream.get()) {
+		local_stream->writeOut();
+		local_stream->reset();
+	} else {
+		local_stream.reset(new LogStream);
+	}
+	return formatStream(*local_stream, level);
+#else
+	static_cast<void>(level);
+	return getDeafstream();
+#endif // PYPLUSPLUS
+}
+
+inline void LogStream::reset()
+{
+	local_stream.str(std::string());
+	local_stream.clear();
+	local_stream.flags(std::ios_base::dec | std::ios_base::skipws);
+	local_stream.width(0);
+	local_stream.precision(6);
+	local_stream.fill(' ');
 }
 
 
@@ -0,0 +1,519 @@
+#pragma once
+
+/**
+ * @file fields.h
+ *
+ * Structured key/value fields attached to log events, shared by the syslog and the log4cxx
+ * backends. Each sink renders them natively: as RFC 5424 structured data for syslog, as MDC
+ * entries for log4cxx layouts (%X{key}) and as JSON members for JSON output.
+ *
+ * Per-event fields are created in the logging statement without copying:
+ *     LOGGER_SYSLOG_FIELDS(INFO, logger::fields("run", run, "chip", name), "run started");
+ *     LOG4CXX_LOG_FIELDS(log, log4cxx::Level::getInfo(), logger::fields("run", run), "started");
+ *
+ * Process-wide static fields (uid, pid, hostname and SLURM_JOBID by default) are computed once and
+ * rendered ahead of time, see StaticFields.
+ */
+
+extern "C" {
+#include <unistd.h>
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * SD-ID of the RFC 5424 structured data element carrying the fields.
+ */
+#ifndef LOGGER_FIELDS_SD_ID
+#define LOGGER_FIELDS_SD_ID "vislog@32473"
+#endif
+
+namespace logger {
+
+/**
+ * Typed key/value pair of a log event. Neither the key nor string values are copied, a Field is
+ * only valid within the logging statement that created it.
+ */
+struct Field
+{
+	typedef std::variant<int64_t, uint64_t, double, bool, std::string_view> Value;
+
+	template <typename T>
+	Field(std::string_view key, T const& value) : key(key), value(make_value(value))
+	{}
+
+	std::string_view key;
+	Value value;
+
+	template <typename T>
+	static Value make_value(T const& value)
+	{
+		if constexpr (std::is_same_v<T, bool>) {
+			return value;
+		} else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+			return static_cast<int64_t>(value);
+		} else if constexpr (std::is_integral_v<T>) {
+			return static_cast<uint64_t>(value);
+		} else if constexpr (std::is_floating_point_v<T>) {
+			return static_cast<double>(value);
+		} else {
+			return std::string_view(value);
+		}
+	}
+};
+
+/**
+ * Non-owning range of fields, cheap to pass by value.
+ */
+class Fields
+{
+public:
+	Fields() : m_begin(nullptr), m_size(0) {}
+
+	template <size_t N>
+	Fields(std::array<Field, N> const& fields) : m_begin(fields.data()), m_size(N)
+	{}
+
+	Fields(Field const* begin, size_t size) : m_begin(begin), m_size(size) {}
+
+	Field const* begin() const
+	{
+		return m_begin;
+	}
+
+	Field const* end() const
+	{
+		return m_begin + m_size;
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	bool empty() const
+	{
+		return m_size == 0;
+	}
+
+private:
+	Field const* m_begin;
+	size_t m_size;
+};
+
+namespace detail {
+
+template <typename Tuple, size_t... I>
+std::array<Field, sizeof...(I)> make_fields(Tuple const& args, std::index_sequence<I...>)
+{
+	return {{Field(std::get<2 * I>(args), std::get<2 * I + 1>(args))...}};
+}
+
+/**
+ * Output writing into a fixed memory region, silently truncating. Same interface as the subset
+ * of std::string used by the renderers below.
+ */
+class FixedOutput
+{
+public:
+	FixedOutput(char* begin, size_t capacity) : m_begin(begin), m_size(0), m_capacity(capacity) {}
+
+	void append(char const* data, size_t size)
+	{
+		size = std::min(size, m_capacity - m_size);
+		std::memcpy(m_begin + m_size, data, size);
+		m_size += size;
+	}
+
+	void push_back(char c)
+	{
+		if (m_size < m_capacity) {
+			m_begin[m_size++] = c;
+		}
+	}
+
+	size_t size() const
+	{
+		return m_size;
+	}
+
+	/// shrink to given size, e.g. to drop incomplete output
+	void resize(size_t size)
+	{
+		m_size = std::min(size, m_size);
+	}
+
+	size_t capacity() const
+	{
+		return m_capacity;
+	}
+
+private:
+	char* m_begin;
+	size_t m_size;
+	size_t m_capacity;
+};
+
+template <typename Output>
+void append(Output& out, std::string_view text)
+{
+	out.append(text.data(), text.size());
+}
+
+/**
+ * Render value without quoting or escaping.
+ */
+template <typename Output>
+void append_value(Output& out, Field::Value const& value)
+{
+	char buffer[32];
+	std::to_chars_result res{buffer, std::errc()};
+	switch (value.index()) {
+		case 0:
+			res = std::to_chars(buffer, buffer + sizeof(buffer), std::get<int64_t>(value));
+			break;
+		case 1:
+			res = std::to_chars(buffer, buffer + sizeof(buffer), std::get<uint64_t>(value));
+			break;
+		case 2:
+			res = std::to_chars(buffer, buffer + sizeof(buffer), std::get<double>(value));
+			break;
+		case 3:
+			append(out, std::get<bool>(value) ? "true" : "false");
+			return;
+		default:
+			append(out, std::get<std::string_view>(value));
+			return;
+	}
+	out.append(buffer, static_cast<size_t>(res.ptr - buffer));
+}
+
+/**
+ * RFC 5424 PARAM-NAME: printable US-ASCII except '=', ' ', ']' and '"', at most 32 characters.
+ * Other characters are replaced by '_'.
+ */
+template <typename Output>
+void append_sd_name(Output& out, std::string_view key)
+{
+	key = key.substr(0, 32);
+	for (char c : key) {
+		bool const valid = c > ' ' && c < 127 && c != '=' && c != ']' && c != '"';
+		out.push_back(valid ? c : '_');
+	}
+}
+
+/**
+ * RFC 5424 PARAM-VALUE, with '"', '\' and ']' escaped.
+ */
+template <typename Output>
+void append_sd_value(Output& out, Field::Value const& value)
+{
+	if (value.index() != 4) {
+		append_value(out, value);
+		return;
+	}
+	for (char c : std::get<std::string_view>(value)) {
+		if (c == '"' || c == '\\' || c == ']') {
+			out.push_back('\\');
+		}
+		out.push_back(c);
+	}
+}
+
+/**
+ * Length of the prefix of text not requiring JSON escaping, i.e. without quotes, backslashes and
+ * control characters. Checks 16 bytes at a time where SSE2 is available, as most log messages
+ * contain nothing to escape.
+ */
+inline size_t json_plain_prefix(char const* data, size_t size)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	__m128i const quote = _mm_set1_epi8('"');
+	__m128i const backslash = _mm_set1_epi8('\\');
+	__m128i const last_control = _mm_set1_epi8(0x1f);
+	for (; i + 16 <= size; i += 16) {
+		__m128i const chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i));
+		// unsigned chunk <= 0x1f
+		__m128i const control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, last_control), chunk);
+		__m128i const special = _mm_or_si128(
+		    control, _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+		int const mask = _mm_movemask_epi8(special);
+		if (mask != 0) {
+			return i + static_cast<size_t>(__builtin_ctz(mask));
+		}
+	}
+#endif
+	for (; i < size; ++i) {
+		unsigned char const c = static_cast<unsigned char>(data[i]);
+		if (c < 0x20 || c == '"' || c == '\\') {
+			break;
+		}
+	}
+	return i;
+}
+
+/**
+ * JSON string contents, escaping quotes, backslashes and control characters. Plain runs are
+ * copied at once.
+ */
+template <typename Output>
+void append_json_string(Output& out, std::string_view text)
+{
+	static char const hex[] = "0123456789abcdef";
+	char const* data = text.data();
+	size_t size = text.size();
+	while (size > 0) {
+		size_t const plain = json_plain_prefix(data, size);
+		out.append(data, plain);
+		if (plain == size) {
+			return;
+		}
+		char const c = data[plain];
+		switch (c) {
+			case '"':
+				append(out, "\\\"");
+				break;
+			case '\\':
+				append(out, "\\\\");
+				break;
+			case '\n':
+				append(out, "\\n");
+				break;
+			case '\t':
+				append(out, "\\t");
+				break;
+			case '\r':
+				append(out, "\\r");
+				break;
+			default: {
+				unsigned char const u = static_cast<unsigned char>(c);
+				char const escaped[] = {'\\', 'u', '0', '0', hex[u >> 4], hex[u & 0xf]};
+				out.append(escaped, sizeof(escaped));
+			}
+		}
+		data += plain + 1;
+		size -= plain + 1;
+	}
+}
+
+} // namespace detail
+
+/**
+ * Create fields from alternating keys and values, e.g. fields("run", 3, "chip", "w62").
+ * Integral, floating point, bool and string values are supported.
+ */
+template <typename... Args>
+std::array<Field, sizeof...(Args) / 2> fields(Args const&... args)
+{
+	static_assert(sizeof...(Args) % 2 == 0, "fields() takes pairs of keys and values");
+	return detail::make_fields(
+	    std::forward_as_tuple(args...), std::make_index_sequence<sizeof...(Args) / 2>());
+}
+
+/**
+ * Append ' key="value"' RFC 5424 SD-PARAMs for all fields.
+ */
+template <typename Output>
+void append_sd_params(Output& out, Fields fields)
+{
+	for (Field const& field : fields) {
+		out.push_back(' ');
+		detail::append_sd_name(out, field.key);
+		detail::append(out, "=\"");
+		detail::append_sd_value(out, field.value);
+		out.push_back('"');
+	}
+}
+
+/**
+ * Append '"key":value' JSON members for all fields, each preceded by a comma.
+ */
+template <typename Output>
+void append_json_members(Output& out, Fields fields)
+{
+	for (Field const& field : fields) {
+		detail::append(out, ",\"");
+		detail::append_json_string(out, field.key);
+		detail::append(out, "\":");
+		if (field.value.index() == 4) {
+			out.push_back('"');
+			detail::append_json_string(out, std::get<std::string_view>(field.value));
+			out.push_back('"');
+		} else if (field.value.index() == 2 && !std::isfinite(std::get<double>(field.value))) {
+			detail::append(out, "null");
+		} else {
+			detail::append_value(out, field.value);
+		}
+	}
+}
+
+/**
+ * Field value rendered as plain text, e.g. for MDC entries.
+ */
+inline std::string to_string(Field::Value const& value)
+{
+	std::string ret;
+	detail::append_value(ret, value);
+	return ret;
+}
+
+/**
+ * Process-wide fields attached to all events of the sinks supporting them, with the renderings
+ * computed ahead of time. Defaults to uid, pid, hostname and, if set, SLURM_JOBID.
+ *
+ * Sinks read an immutable snapshot without locking. Setting a field publishes a new snapshot, the
+ * previous one is leaked on purpose as concurrent senders may still use it; static fields are
+ * expected to be set a few times during startup only.
+ */
+class StaticFields
+{
+public:
+	struct Snapshot
+	{
+		/// owned copies of keys and string values
+		std::vector<std::pair<std::string, std::string>> storage;
+		std::vector<Field> fields;
+		/// ' key="value"' SD-PARAMs
+		std::string sd_params;
+		/// ',"key":value' JSON members
+		std::string json_members;
+		/// 'key=value key=value'
+		std::string text;
+	};
+
+	static StaticFields& instance()
+	{
+		// leaked on purpose, used during static destruction
+		static StaticFields* fields = new StaticFields;
+		return *fields;
+	}
+
+	Snapshot const& get() const
+	{
+		return *m_snapshot.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Add or replace a static field.
+	 */
+	template <typename T>
+	void set(std::string_view key, T const& value)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Snapshot const& current = get();
+		std::vector<std::pair<std::string, Field::Value>> entries;
+		bool replaced = false;
+		for (Field const& field : current.fields) {
+			bool const match = (field.key == key);
+			entries.emplace_back(field.key, match ? Field::make_value(value) : field.value);
+			replaced = replaced || match;
+		}
+		if (!replaced) {
+			entries.emplace_back(key, Field::make_value(value));
+		}
+		m_snapshot.store(make_snapshot(entries), std::memory_order_release);
+	}
+
+	/**
+	 * Remove a static field, if present.
+	 */
+	void remove(std::string_view key)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<std::pair<std::string, Field::Value>> entries;
+		for (Field const& field : get().fields) {
+			if (field.key != key) {
+				entries.emplace_back(field.key, field.value);
+			}
+		}
+		m_snapshot.store(make_snapshot(entries), std::memory_order_release);
+	}
+
+private:
+	StaticFields()
+	{
+		std::vector<std::pair<std::string, Field::Value>> entries;
+		entries.emplace_back("uid", Field::make_value(getuid()));
+		entries.emplace_back("pid", Field::make_value(getpid()));
+
+		char hostname[256];
+		if (gethostname(hostname, sizeof(hostname)) == 0) {
+			hostname[sizeof(hostname) - 1] = '\0';
+			entries.emplace_back("hostname", Field::make_value(hostname));
+		}
+		char const* slurm_job_id = std::getenv("SLURM_JOBID");
+		if (slurm_job_id != nullptr) {
+			entries.emplace_back("SLURM_JOBID", Field::make_value(slurm_job_id));
+		}
+		m_snapshot.store(make_snapshot(entries));
+	}
+
+	/**
+	 * Copy entries into a new snapshot, string values referenced by entries may be invalidated
+	 * afterwards.
+	 */
+	static Snapshot* make_snapshot(std::vector<std::pair<std::string, Field::Value>> const& entries)
+	{
+		Snapshot* snapshot = new Snapshot;
+		snapshot->storage.reserve(entries.size());
+		snapshot->fields.reserve(entries.size());
+		for (auto const& [key, value] : entries) {
+			std::string string_value;
+			if (value.index() == 4) {
+				string_value = std::get<std::string_view>(value);
+			}
+			snapshot->storage.emplace_back(key, std::move(string_value));
+			auto const& stored = snapshot->storage.back();
+			Field field(stored.first, 0);
+			field.value = (value.index() == 4) ? Field::make_value(stored.second) : value;
+			snapshot->fields.push_back(field);
+		}
+
+		Fields const fields(snapshot->fields.data(), snapshot->fields.size());
+		append_sd_params(snapshot->sd_params, fields);
+		append_json_members(snapshot->json_members, fields);
+		for (Field const& field : fields) {
+			if (!snapshot->text.empty()) {
+				snapshot->text.push_back(' ');
+			}
+			snapshot->text.append(field.key);
+			snapshot->text.push_back('=');
+			detail::append_value(snapshot->text, field.value);
+		}
+		return snapshot;
+	}
+
+	std::mutex m_mutex;
+	std::atomic<Snapshot const*> m_snapshot;
+};
+
+/**
+ * Set a process-wide static field, cf. StaticFields.
+ */
+template <typename T>
+void set_static_field(std::string_view key, T const& value)
+{
+	StaticFields::instance().set(key, value);
+}
+
+} // namespace logger
@@ -0,0 +1,57 @@
+#pragma once
+
+/**
+ * @file fixed_stream.h
+ *
+ * Formatting into fixed memory regions without allocating, shared by the native syslog client and
+ * the log4cxx context ring. Their streams are reused for every message of a thread.
+ */
+
+#include <cstddef>
+#include <ios>
+#include <ostream>
+#include <streambuf>
+
+namespace logger {
+
+namespace detail {
+
+/**
+ * Stream buffer writing into a fixed memory region, silently truncating.
+ */
+class FixedStreamBuffer : public std::streambuf
+{
+public:
+	void reset(char* begin, char* end)
+	{
+		setp(begin, end);
+	}
+
+	size_t size() const
+	{
+		return static_cast<size_t>(pptr() - pbase());
+	}
+
+protected:
+	int_type overflow(int_type) override
+	{
+		return traits_type::eof();
+	}
+};
+
+/**
+ * Reset a reused stream to the state of a new one, so manipulators of the previous message (e.g.
+ * std::hex) do not leak into the next.
+ */
+inline void reset_stream(std::ostream& stream)
+{
+	stream.clear();
+	stream.flags(std::ios_base::dec | std::ios_base::skipws);
+	stream.precision(6);
+	stream.width(0);
+	stream.fill(' ');
+}
+
+} // namespace detail
+
+} // namespace logger
@@ -0,0 +1,94 @@
+#pragma once
+
+/**
+ * @file appender_snapshot.h
+ *
+ * Immutable snapshots of the appenders reached by the events of a logger, for code that only
+ * inspects the configuration, e.g. "is this logger configured?" checks on every message:
+ *     if (!visionary_logger::has_appenders(logger)) { ... }
+ *
+ * Logger::getAllAppenders() copies the appender list under the logger's lock on every call. A
+ * snapshot is built once per logger after each configuration change and shared by all threads;
+ * each thread remembers the snapshots it used, so the checks take neither a lock nor a copy.
+ * Threads only hold weak references: appenders removed from the configuration are released
+ * once any thread takes its next snapshot.
+ *
+ * Snapshots only serve such checks. Events are still dispatched by log4cxx's
+ * Logger::callAppenders, which cannot be replaced without patching log4cxx.
+ *
+ * Snapshots are invalidated when log4cxx reports appenders being added, by the configuration
+ * functions of logging_ctrl.h, CompiledConfig::apply and pylogging. log4cxx does not report every
+ * change (e.g. Logger::setAdditivity, Logger::removeAppender, Logger::removeAllAppenders or
+ * BasicConfigurator::resetConfiguration), snapshots may lag behind these until the next reported
+ * one or appenders_changed(). has_appenders() confirms its answer on the logger itself and is
+ * always up to date.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <log4cxx/appender.h>
+#include <log4cxx/logger.h>
+
+namespace visionary_logger {
+
+/**
+ * Appenders an event of a logger is passed to: its own ones, followed by those of its ancestors up
+ * to the first one without additivity.
+ */
+struct AppenderChain
+{
+	log4cxx::AppenderList appenders;
+	/// number of leading appenders attached to the logger itself
+	size_t own;
+};
+
+typedef std::shared_ptr<AppenderChain const> AppenderChainPtr;
+
+namespace detail {
+
+/// incremented on every configuration change
+extern std::atomic<uint64_t> appender_generation;
+
+/// what the checks below need from a chain, kept by each thread without owning appenders
+struct ChainSummary
+{
+	size_t own;
+	size_t total;
+};
+
+ChainSummary const& chain_summary(log4cxx::Logger const* logger);
+
+} // namespace detail
+
+/**
+ * Current snapshot of the logger's appenders.
+ */
+AppenderChainPtr appender_chain(log4cxx::LoggerPtr const& logger);
+
+/**
+ * Whether the logger itself has appenders, without copying its appender list.
+ * A configured logger is confirmed by its first appender still being attached, otherwise the
+ * appender list is checked.
+ */
+bool has_appenders(log4cxx::LoggerPtr const& logger);
+
+/**
+ * Whether events of the logger reach any appender, according to the current snapshot.
+ */
+inline bool reaches_appenders(log4cxx::LoggerPtr const& logger)
+{
+	return detail::chain_summary(logger.get()).total != 0;
+}
+
+/**
+ * Invalidate all snapshots, e.g. after removing appenders through log4cxx directly.
+ */
+inline void appenders_changed()
+{
+	detail::appender_generation.fetch_add(1, std::memory_order_release);
+}
+
+} // namespace visionary_logger
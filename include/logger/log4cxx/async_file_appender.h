@@ -0,0 +1,67 @@
+#pragma once
+
+/**
+ * @file async_file_appender.h
+ *
+ * Appender handing formatted events to a background writer thread instead of writing them on the
+ * logging thread, see logger::AsyncFile:
+ *     logger_write_to_file_async("run.log");
+ *
+ * Appending never waits for the file system: if the writer falls behind, e.g. on a stalling
+ * network file system, events are dropped and their number is reported when the appender is
+ * closed.
+ */
+
+#include <memory>
+#include <string>
+
+#include <log4cxx/appenderskeleton.h>
+
+#include "logger/async_file.h"
+
+namespace log4cxx {
+
+class AsyncFileAppender : public AppenderSkeleton
+{
+public:
+	/**
+	 * @throws std::system_error if the file cannot be opened, or io_uring is requested but not
+	 *                           available
+	 */
+	AsyncFileAppender(
+	    LayoutPtr const& layout,
+	    std::string const& filename,
+	    bool append = true,
+	    logger::AsyncFile::Backend backend = logger::AsyncFile::Backend::automatic);
+
+	~AsyncFileAppender() override;
+
+	void close() override;
+
+	bool requiresLayout() const override
+	{
+		return true;
+	}
+
+	/**
+	 * Wait until all events appended so far are written.
+	 */
+	void flush();
+
+	logger::AsyncFile const& file() const
+	{
+		return *m_file;
+	}
+
+protected:
+	void append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool) override;
+
+private:
+	std::unique_ptr<logger::AsyncFile> m_file;
+	/// formatting buffer, appending is serialized by AppenderSkeleton
+	LogString m_buffer;
+};
+
+LOG4CXX_PTR_DEF(AsyncFileAppender);
+
+} // namespace log4cxx
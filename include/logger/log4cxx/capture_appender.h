@@ -0,0 +1,122 @@
+#pragma once
+
+/**
+ * @file capture_appender.h
+ *
+ * Appender keeping the most recent events in memory, e.g. for tests checking log output or for
+ * diagnostics endpoints, without any file I/O.
+ *
+ * Usage:
+ *     log4cxx::CaptureAppenderPtr capture(new log4cxx::CaptureAppender(100));
+ *     logger->addAppender(capture);
+ *     ...
+ *     for (auto const& event : capture->events()) { ... }
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <log4cxx/appenderskeleton.h>
+
+namespace log4cxx {
+
+/**
+ * Copy of a captured event.
+ */
+struct CapturedEvent
+{
+	/// microseconds since epoch
+	int64_t timestamp;
+	LevelPtr level;
+	std::string logger;
+	std::string message;
+};
+
+/**
+ * Appender storing events in a fixed-capacity ring, overwriting the oldest events once full. All
+ * memory is allocated on construction, appending an event copies into preallocated slots and
+ * truncates messages exceeding the slot size.
+ */
+class CaptureAppender : public AppenderSkeleton
+{
+public:
+	/**
+	 * @param capacity Number of events kept.
+	 * @param threshold Only events at or above this level are captured.
+	 * @param message_size Maximum size of captured messages, longer ones are truncated
+	 *                     at a UTF-8 character boundary.
+	 */
+	CaptureAppender(
+	    size_t capacity = 1024,
+	    LevelPtr const& threshold = Level::getAll(),
+	    size_t message_size = 1024);
+
+	~CaptureAppender() override;
+
+	void close() override;
+
+	/**
+	 * Events are captured unformatted, no layout needed.
+	 */
+	bool requiresLayout() const override
+	{
+		return false;
+	}
+
+	/**
+	 * Copy of the captured events, oldest first.
+	 */
+	std::vector<CapturedEvent> events() const;
+
+	/**
+	 * Messages of the captured events, oldest first.
+	 */
+	std::vector<std::string> messages() const;
+
+	/**
+	 * Number of events currently captured.
+	 */
+	size_t size() const;
+
+	size_t capacity() const;
+
+	/**
+	 * Number of events captured since construction or the last clear(), including overwritten
+	 * ones.
+	 */
+	size_t total() const;
+
+	/**
+	 * Forget all captured events.
+	 */
+	void clear();
+
+protected:
+	void append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool&) override;
+
+private:
+	struct Slot;
+
+	/// copy slot into event, requires m_ring_mutex
+	void copy(Slot const& slot, CapturedEvent& event) const;
+
+	/// i-th oldest captured slot, requires m_ring_mutex
+	Slot const& slot(size_t i) const;
+
+	size_t const m_capacity;
+	size_t const m_message_size;
+	std::unique_ptr<Slot[]> m_slots;
+	/// holds the message and logger name buffers of all slots
+	std::unique_ptr<char[]> m_storage;
+	size_t m_total;
+
+	mutable std::mutex m_ring_mutex;
+};
+
+LOG4CXX_PTR_DEF(CaptureAppender);
+
+} // namespace log4cxx
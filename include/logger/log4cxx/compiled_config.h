@@ -0,0 +1,98 @@
+#pragma once
+
+/**
+ * @file compiled_config.h
+ *
+ * Precompiled logger configuration for processes started in large numbers, e.g. one per SLURM
+ * task: the properties file is parsed once when the job is set up,
+ *     logger_compile_config("symap2ic_logger.conf", "job_logger.conf.bin");
+ * and every process applies the binary file without PropertyConfigurator, i.e. without parsing,
+ * variable substitution and class lookup by name:
+ *     SYMAP2IC_LOGGER_CONF=job_logger.conf.bin srun ...
+ * logger_config_from_file() and logger_default_config() accept compiled files transparently.
+ *
+ * Only the subset of properties used by our configurations compiles: root and named loggers with
+ * levels, appender references and additivity, ConsoleAppender and FileAppender with Target, File,
+ * Append, ImmediateFlush, Threshold and a PatternLayout. Anything else is rejected when compiling;
+ * such files can still be loaded by logger_config_from_file().
+ *
+ * The binary format is little endian on every host. Files of an older format version are rejected
+ * and have to be compiled again.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <log4cxx/logmanager.h>
+#include <log4cxx/spi/loggerrepository.h>
+
+namespace visionary_logger {
+
+struct CompiledConfig
+{
+	/// level or additivity not given in the file, the current value is kept
+	static constexpr int8_t keep = -1;
+
+	struct Appender
+	{
+		std::string name;
+		bool console;
+		/// file name, or System.out/System.err for console appenders
+		std::string target;
+		bool append;
+		bool immediate_flush;
+		int8_t has_threshold;
+		int32_t threshold;
+		std::string pattern;
+	};
+
+	struct Logger
+	{
+		/// empty for the root logger
+		std::string name;
+		/// keep, 0 to inherit the level, 1 to set it
+		int8_t has_level;
+		int32_t level;
+		/// keep, 0 or 1
+		int8_t additive;
+		/// named by a log4j.logger/rootLogger line, which replaces the logger's appenders
+		bool has_appenders;
+		std::vector<std::string> appenders;
+	};
+
+	std::vector<Appender> appenders;
+	std::vector<Logger> loggers;
+
+	/**
+	 * Parse a properties file.
+	 * @throws std::runtime_error if the file cannot be read or uses unsupported properties
+	 */
+	static CompiledConfig parse(std::string const& filename);
+
+	/**
+	 * Read a file written by save().
+	 * @throws std::runtime_error if the file cannot be read or is not a compiled configuration
+	 */
+	static CompiledConfig load(std::string const& filename);
+
+	/**
+	 * Whether the file starts like a file written by save().
+	 */
+	static bool is_compiled(std::string const& filename);
+
+	/**
+	 * @throws std::runtime_error if the file cannot be written
+	 */
+	void save(std::string const& filename) const;
+
+	/**
+	 * Configure the repository as PropertyConfigurator would for the source file: the appenders
+	 * of loggers with a log4j.logger or log4j.rootLogger line are replaced.
+	 */
+	void apply(
+	    log4cxx::spi::LoggerRepositoryPtr repository =
+	        log4cxx::LogManager::getLoggerRepository()) const;
+};
+
+} // namespace visionary_logger
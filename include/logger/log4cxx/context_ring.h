@@ -0,0 +1,85 @@
+#pragma once
+
+/**
+ * @file context_ring.h
+ *
+ * Per-thread lossy ring of recent events suppressed by the logger level. When LOG4CXX_ERROR or
+ * LOG4CXX_FATAL logs, the events recorded by the same thread are passed to the appenders first,
+ * so an error logged at WARN level still comes with the DEBUG context leading up to it.
+ *
+ * Recording is disabled by default and then costs one relaxed load per suppressed message. When
+ * enabled, the message text is streamed into a preallocated per-thread slot; creating the event
+ * and formatting it through the layouts is deferred until an error dumps the ring.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+
+#include <log4cxx/level.h>
+#include <log4cxx/logger.h>
+
+namespace visionary_logger {
+
+namespace detail {
+
+/// whether suppressed events are recorded, cf. enable_context_ring()
+inline std::atomic<bool> context_ring_enabled{false};
+
+class ContextRing;
+
+} // namespace detail
+
+/**
+ * Record the last events suppressed by the logger level in each thread.
+ * @param events Number of events kept per thread, 0 disables recording.
+ * @param message_size Maximum size of recorded messages, longer ones are truncated.
+ */
+void enable_context_ring(size_t events = 32, size_t message_size = 256);
+
+/**
+ * Stop recording suppressed events, recorded events are dropped.
+ */
+void disable_context_ring();
+
+/**
+ * Whether suppressed events are currently recorded.
+ */
+inline bool context_ring_enabled()
+{
+	return detail::context_ring_enabled.load(std::memory_order_relaxed);
+}
+
+/**
+ * Pass the events recorded by the calling thread to the appenders of their loggers, oldest first,
+ * and clear the ring. Messages are prefixed by their age. Called by LOG4CXX_ERROR and
+ * LOG4CXX_FATAL.
+ */
+void dump_context_ring();
+
+/**
+ * Records one suppressed event into the calling thread's ring. The message is streamed into
+ * stream() and committed on destruction, i.e. at the end of the logging statement.
+ */
+class ContextRecord
+{
+public:
+	ContextRecord(
+	    log4cxx::LoggerPtr const& logger,
+	    log4cxx::LevelPtr const& level,
+	    log4cxx::spi::LocationInfo const& location);
+	~ContextRecord();
+
+	ContextRecord(ContextRecord const&) = delete;
+	ContextRecord& operator=(ContextRecord const&) = delete;
+
+	std::ostream& stream();
+
+private:
+	detail::ContextRing* m_ring;
+};
+
+} // namespace visionary_logger
@@ -0,0 +1,177 @@
+#pragma once
+
+/**
+ * @file fanout_appender.h
+ *
+ * Appender writing each event to several sinks from a single formatting pass, replacing one
+ * appender with its own PatternLayout per sink, e.g. console and file of
+ * logger_default_config(..., dual=true):
+ *     log4cxx::FanOutAppenderPtr fanout(new log4cxx::FanOutAppender);
+ *     fanout->add_console();
+ *     fanout->add_file("run.log");
+ *     fanout->add_syslog();
+ *     logger->addAppender(fanout);
+ *
+ * The level tag, timestamp, logger name and message body are formatted once per event, level tags
+ * with and without color codes once per process; sinks only select their decorations (color
+ * codes, date format, location) and write the pieces with a single call. The output matches the
+ * patterns of logger_write_to_cout ("%Y%-5p%y %d{...}  %c %m") and logger_write_to_file
+ * ("%-5p %d{ISO8601}  %c %m").
+ *
+ * ConsoleLayout formats the console lines the same way for appenders that need a layout, e.g. the
+ * ConsoleAppender of logger_write_to_cout, whose writer pylogging users replace.
+ */
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <log4cxx/appenderskeleton.h>
+#include <log4cxx/layout.h>
+
+namespace log4cxx {
+
+class FanOutAppender : public AppenderSkeleton
+{
+public:
+	/// %-5p and %Y%-5p%y of PatternLayout
+	struct LevelTags
+	{
+		std::string plain;
+		std::string colored;
+	};
+
+	/// formatted once per process, null for custom levels
+	static LevelTags const* predefined_level_tags(LevelPtr const& level);
+
+	/// supported date formats of PatternLayout's %d{...}
+	enum class DateFormat
+	{
+		none,
+		/// HH:mm:ss,SSS
+		absolute,
+		/// dd MMM yyyy HH:mm:ss,SSS
+		date,
+		/// yyyy-MM-dd HH:mm:ss,SSS
+		iso8601
+	};
+
+	/**
+	 * Parse the names accepted by logger_default_config.
+	 * @return false for names without a fixed format, e.g. RELATIVE
+	 */
+	static bool parse_date_format(std::string const& name, DateFormat& format);
+
+	FanOutAppender();
+	~FanOutAppender() override;
+
+	void close() override;
+
+	bool requiresLayout() const override
+	{
+		return false;
+	}
+
+	/**
+	 * Write to a console stream, not closed by the appender. Events go through the stream's
+	 * buffer, i.e. in order with the application's own output, and the stream is flushed after
+	 * every event like by ConsoleAppender.
+	 * @param color Write ANSI color codes, cf. logger_console_colors()
+	 * @param buffered Only flush after events at or above ERROR and on close(), the C library
+	 * writes out the rest at exit. Saves a write per event on pipes and files, where events may
+	 * then appear late and are lost if the process is killed.
+	 */
+	void add_console(
+	    bool color = true,
+	    DateFormat date = DateFormat::absolute,
+	    bool location = false,
+	    FILE* stream = stdout,
+	    bool buffered = false);
+
+	/**
+	 * @throws std::runtime_error if the file cannot be opened
+	 */
+	void add_file(
+	    std::string const& filename,
+	    bool append = true,
+	    DateFormat date = DateFormat::iso8601,
+	    bool location = false);
+
+	/**
+	 * Mirror errors to syslog instead of the LOG4CXX_ERROR/LOG4CXX_FATAL macros, which skip their
+	 * own syslog message for events written by this sink.
+	 */
+	void add_syslog();
+
+protected:
+	void append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool) override;
+
+private:
+	enum class Kind
+	{
+		console,
+		file,
+		syslog
+	};
+
+	struct Sink
+	{
+		Kind kind;
+		bool color;
+		DateFormat date;
+		bool location;
+		FILE* stream;
+		int fd;
+		bool buffered;
+	};
+
+	/// formatted date of the current event, computed on first use
+	std::string const& date(DateFormat format);
+
+	std::vector<Sink> m_sinks;
+
+	// per-event buffers, appending is serialized by AppenderSkeleton
+	time_t m_second;
+	struct tm m_time;
+	int m_millisecond;
+	std::string m_dates[4];
+	bool m_date_valid[4];
+	std::string m_body;
+	std::string m_location;
+	std::string m_console;
+	std::string m_syslog;
+	/// tags of custom levels
+	LevelTags m_custom_tags;
+};
+
+LOG4CXX_PTR_DEF(FanOutAppender);
+
+/**
+ * Layout of logger_write_to_cout, "%Y%-5p%y %d{HH:mm:ss,SSS}  %c %m%n", formatted in one pass with
+ * the level tags of FanOutAppender instead of PatternLayout's converters.
+ */
+class ConsoleLayout : public Layout
+{
+public:
+	/// @param color Write ANSI color codes, cf. logger_console_colors()
+	explicit ConsoleLayout(bool color = true);
+
+	void format(
+	    LogString& output,
+	    const spi::LoggingEventPtr& event,
+	    log4cxx::helpers::Pool& pool) const override;
+
+	bool ignoresThrowable() const override;
+
+	void activateOptions(log4cxx::helpers::Pool&) override {}
+
+	void setOption(const LogString&, const LogString&) override {}
+
+private:
+	bool const m_color;
+};
+
+LOG4CXX_PTR_DEF(ConsoleLayout);
+
+} // namespace log4cxx
@@ -0,0 +1,40 @@
+#pragma once
+
+/**
+ * @file json_layout.h
+ *
+ * Layout writing one JSON object per event and line, e.g.
+ *     {"time_ns":1600000000123456000,"level":"ERROR","logger":"a.b","thread":"0x7f..",
+ *      "file":"x.cpp","line":12,"message":"failed","backtrace":["./a.out(+0x1234)",..],
+ *      "uid":1000,"pid":42,...}
+ *
+ * Newlines within messages are escaped, so every line can be parsed on its own. The backtrace
+ * appended by LOG4CXX_ERROR and LOG4CXX_FATAL (cf. print_backtrace()) is split off the message into
+ * a separate array. Structured fields (cf. LOG4CXX_LOG_FIELDS) and static fields are added as
+ * members.
+ */
+
+#include <log4cxx/layout.h>
+
+namespace log4cxx {
+
+class JSONLinesLayout : public Layout
+{
+public:
+	void format(
+	    LogString& output,
+	    const spi::LoggingEventPtr& event,
+	    log4cxx::helpers::Pool& pool) const override;
+
+	LogString getContentType() const override;
+
+	bool ignoresThrowable() const override;
+
+	void activateOptions(log4cxx::helpers::Pool& pool) override;
+
+	void setOption(const LogString& option, const LogString& value) override;
+};
+
+LOG4CXX_PTR_DEF(JSONLinesLayout);
+
+} // namespace log4cxx
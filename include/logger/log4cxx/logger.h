@@ -13,11 +13,17 @@
 #include <log4cxx/logger.h>
 #include <log4cxx/propertyconfigurator.h>
 
+#include "logger/fields.h"
+#include "logger/log4cxx/context_ring.h"
 #include "logger/log4cxx/logging_ctrl.h"
+#include "logger/log4cxx/sampling.h"
+#include "logger/log4cxx/thread_level.h"
 
 #define LOGGER_DEFAULT_LEVEL Logger::WARNING
 
 namespace visionary_logger {
+/// prefix of each line of print_backtrace()
+constexpr char backtrace_prefix[] = "print_trace: ";
 std::string print_backtrace() __attribute__((unused));
 std::string make_syslog_prefix() __attribute__((unused));
 /// Prints a message to syslog, a prefix with general information will be added
@@ -32,8 +38,90 @@ void write_to_syslog(
     log4cxx::LevelPtr level,
     log4cxx::LoggerPtr logger,
     log4cxx::spi::LocationInfo loc) __attribute__((unused));
+
+/// Logs message with structured fields, cf. logger/fields.h. While the event is appended, the
+/// fields and the static fields are MDC entries of the calling thread, i.e. available to
+/// layouts as %X{key}, and current_fields() returns the typed fields.
+void forced_log_with_fields(
+    log4cxx::LoggerPtr const& logger,
+    log4cxx::LevelPtr const& level,
+    std::string const& message,
+    log4cxx::spi::LocationInfo const& location,
+    logger::Fields fields);
+
+/// Fields of the event the calling thread currently appends, empty outside of
+/// LOG4CXX_LOG_FIELDS.
+logger::Fields current_fields();
+
+namespace detail {
+
+/// syslog mirror of the ERROR or FATAL event the calling thread is logging, written by the macro
+/// unless a FanOutAppender with a syslog sink already did while appending
+enum class SyslogMirror
+{
+	none,
+	requested,
+	written
+};
+
+extern thread_local SyslogMirror syslog_mirror;
+
+} // namespace detail
 } // namespace visionary_logger
 
+/// logger macro attaching structured fields to the event
+/// @arg fields: e.g. logger::fields("run", 3, "chip", name)
+#define LOG4CXX_LOG_FIELDS(logger, level, fields, message)                                         \
+	{                                                                                              \
+		::log4cxx::LevelPtr level_ = level;                                                        \
+		if (visionary_logger::enabled_for(logger, level_)) {                                       \
+			::log4cxx::helpers::MessageBuffer oss_;                                                \
+			visionary_logger::forced_log_with_fields(                                              \
+			    logger, level_, oss_.str(oss_ << message), LOG4CXX_LOCATION, fields);              \
+		}                                                                                          \
+	}
+
+/// We redefine the log4cxx's TRACE, DEBUG, INFO and WARN macros to record suppressed events into
+/// the context ring, cf. logger/log4cxx/context_ring.h
+/// (copied macro definitions from log4cxx/logger.h)
+#define VISIONARY_LOGGER_LOG_OR_RECORD(logger, level, enabled, message)                            \
+	{                                                                                              \
+		if (enabled) {                                                                             \
+			::log4cxx::helpers::MessageBuffer oss_;                                                \
+			logger->forcedLog(level, oss_.str(oss_ << message), LOG4CXX_LOCATION);                 \
+		} else if (LOG4CXX_UNLIKELY(visionary_logger::context_ring_enabled())) {                   \
+			visionary_logger::ContextRecord(logger, level, LOG4CXX_LOCATION).stream() << message;  \
+		}                                                                                          \
+	}
+
+#undef LOG4CXX_TRACE
+#define LOG4CXX_TRACE(logger, message)                                                             \
+	VISIONARY_LOGGER_LOG_OR_RECORD(                                                                \
+	    logger, ::log4cxx::Level::getTrace(),                                                      \
+	    VISIONARY_LOGGER_ENABLED(                                                                  \
+	        ::log4cxx::Level::TRACE_INT, LOG4CXX_UNLIKELY(logger->isTraceEnabled())),              \
+	    message)
+
+#undef LOG4CXX_DEBUG
+#define LOG4CXX_DEBUG(logger, message)                                                             \
+	VISIONARY_LOGGER_LOG_OR_RECORD(                                                                \
+	    logger, ::log4cxx::Level::getDebug(),                                                      \
+	    VISIONARY_LOGGER_ENABLED(                                                                  \
+	        ::log4cxx::Level::DEBUG_INT, LOG4CXX_UNLIKELY(logger->isDebugEnabled())),              \
+	    message)
+
+#undef LOG4CXX_INFO
+#define LOG4CXX_INFO(logger, message)                                                              \
+	VISIONARY_LOGGER_LOG_OR_RECORD(                                                                \
+	    logger, ::log4cxx::Level::getInfo(),                                                       \
+	    VISIONARY_LOGGER_ENABLED(::log4cxx::Level::INFO_INT, logger->isInfoEnabled()), message)
+
+#undef LOG4CXX_WARN
+#define LOG4CXX_WARN(logger, message)                                                              \
+	VISIONARY_LOGGER_LOG_OR_RECORD(                                                                \
+	    logger, ::log4cxx::Level::getWarn(),                                                       \
+	    VISIONARY_LOGGER_ENABLED(::log4cxx::Level::WARN_INT, logger->isWarnEnabled()), message)
+
 /// logger macros that print an additional backtrace
 #define LOG4CXX_DEBUG_BACKTRACE(logger, message)                                                   \
 	{                                                                                              \
@@ -73,7 +161,13 @@ void write_to_syslog(
 		::log4cxx::spi::LocationInfo location = LOG4CXX_LOCATION;                                  \
 		::log4cxx::helpers::MessageBuffer oss_;                                                    \
 		std::string throw_message(oss_.str(oss_ << message));                                      \
-		if (logger->isErrorEnabled()) {                                                            \
+		if (VISIONARY_LOGGER_ENABLED(                                                              \
+		        ::log4cxx::Level::ERROR_INT, logger->isErrorEnabled())) {                          \
+			if (visionary_logger::context_ring_enabled()) {                                        \
+				visionary_logger::dump_context_ring();                                             \
+			}                                                                                      \
+			visionary_logger::detail::syslog_mirror =                                              \
+			    visionary_logger::detail::SyslogMirror::requested;                                 \
 			logger->forcedLog(                                                                     \
 			    level, oss_.str(oss_ << visionary_logger::print_backtrace()), location);           \
 		}                                                                                          \
@@ -90,7 +184,13 @@ void write_to_syslog(
 		::log4cxx::spi::LocationInfo location = LOG4CXX_LOCATION;                                  \
 		::log4cxx::helpers::MessageBuffer oss_;                                                    \
 		std::string throw_message(oss_.str(oss_ << message));                                      \
-		if (logger->isFatalEnabled()) {                                                            \
+		if (VISIONARY_LOGGER_ENABLED(                                                              \
+		        ::log4cxx::Level::FATAL_INT, logger->isFatalEnabled())) {                          \
+			if (visionary_logger::context_ring_enabled()) {                                        \
+				visionary_logger::dump_context_ring();                                             \
+			}                                                                                      \
+			visionary_logger::detail::syslog_mirror =                                              \
+			    visionary_logger::detail::SyslogMirror::requested;                                 \
 			logger->forcedLog(                                                                     \
 			    level, oss_.str(oss_ << visionary_logger::print_backtrace()), location);           \
 		}                                                                                          \
@@ -104,8 +204,13 @@ void write_to_syslog(
 log4cxx::LoggerPtr get_default_logger(
     std::string logger_name, log4cxx::LevelPtr level, std::string fname, bool dual);
 
+/// @arg json: Write JSON lines to fname, see JSONLinesLayout
 void configure_default_logger(
-    log4cxx::LoggerPtr logger, log4cxx::LevelPtr level, std::string fname, bool dual);
+    log4cxx::LoggerPtr logger,
+    log4cxx::LevelPtr level,
+    std::string fname,
+    bool dual,
+    bool json = false);
 
 struct Message
 {
@@ -123,7 +228,11 @@ struct Message
 	~Message()
 	{
 		// do the actual logging (triggered by reset of Logger's _buffer)
-		get_default_logger("Default", log4cxx::LevelPtr(), std::string(), false)->log(level(), get().str(), LOG4CXX_LOCATION);
+		log4cxx::LoggerPtr logger =
+		    get_default_logger("Default", log4cxx::LevelPtr(), std::string(), false);
+		if (visionary_logger::enabled_for(logger, level())) {
+			logger->forcedLog(level(), get().str(), LOG4CXX_LOCATION);
+		}
 	}
 
 	static void custom_cleanup(Message*)
@@ -281,12 +390,30 @@ public:
 		return _level;
 	}
 
-	//! Returns whether given log level will produce output
+	//! Returns whether given log level will produce output in the calling thread
 	bool willBeLogged(size_t level)
 	{
+		if (log4cxx::Level const* thread_level = visionary_logger::thread_level()) {
+			return log4cxx_level(level)->toInt() >= thread_level->toInt();
+		}
 		return level <= getLevel();
 	}
 
+	/// Overrides the level of the calling thread within the current scope (RAII-style), for the
+	/// stream API as well as the LOG4CXX_* macros, see visionary_logger::ScopedLevel
+	class AlterLevel
+	{
+	public:
+		explicit AlterLevel(size_t level) : _level(log4cxx_level(level)) {}
+
+		// prevent heap allocation
+		static void* operator new(size_t) = delete;
+		static void* operator new[](size_t) = delete;
+
+	private:
+		visionary_logger::ScopedLevel _level;
+	};
+
 	//! Returns threshold level of the Logger instance
 	std::string getLevelStr()
 	{
@@ -19,38 +19,91 @@
 /// Reset the logger config
 void logger_reset();
 
+/// Configuration file used by logger_default_config, resolved once per process:
+/// $SYMAP2IC_LOGGER_CONF if set (an empty value disables the lookup), otherwise
+/// "symap2ic_logger.conf" if it exists in the working directory at the first call.
+/// Empty if there is none.
+std::string const& logger_config_path();
+
+/// Whether logger_config_path() was given by $SYMAP2IC_LOGGER_CONF
+bool logger_config_from_environment();
+
 /// This is the default configuration procedure for the logger
-/// If the file ""symap2ic_logger.conf" is found, it is used to configure the
+/// If the file logger_config_path() is found, it is used to configure the
 /// logger and every other argument is ignored!
 /// @level: Log level
 /// @arg fname: Log to this file, if empty to stdout
 /// @arg dual: If file is given, log also to stdout
 /// @print_location: Include location of error into log message
-/// @use_color: Print colorfull, affects only console output
+/// @use_color: Print colorfull, affects only console output, see logger_console_colors
 /// @arg date_format: values are: NULL, RELATIVE, ABSOLUTE, DATE, ISO8601
+/// @arg json: Write JSON lines to the file, see JSONLinesLayout
+/// @arg watch: Reload logger_config_path() whenever it changes, see logger_watch_config
+/// @arg fanout: Unless json is set or date_format is RELATIVE/NULL, write console, file and the
+/// syslog mirror of errors by a single FanOutAppender named "FANOUT", replacing the appenders
+/// "COUT" and "FILE" of the root logger. Otherwise "COUT" and "FILE" are added as by
+/// configure_default_logger.
 void logger_default_config(
 		log4cxx::LevelPtr level = log4cxx::Level::getWarn(),
 		std::string fname = "",
 		bool dual = false,
 		bool print_location = false,
 		bool use_color = true,
-		std::string date_format = "ABSOLUTE");
+		std::string date_format = "ABSOLUTE",
+		bool json = false,
+		bool watch = false,
+		bool fanout = false);
 
-/// Load logger config from the given configuration file
+/// Load logger config from the given configuration file, either a properties file or a file
+/// written by logger_compile_config
 /// @see ???
 void logger_config_from_file(std::string filename);
 
+/// Parse a properties file once and write it in the binary form applied without
+/// PropertyConfigurator, see CompiledConfig
+void logger_compile_config(std::string const& filename, std::string const& output);
+
+/// Load logger config from the given configuration file into a ReloadableAppender replacing all
+/// appenders of the root logger, and reload it whenever the file changes. Reloads never close
+/// appenders other threads are logging to.
+log4cxx::AppenderPtr logger_watch_config(std::string const& filename = "symap2ic_logger.conf");
+
 /// adds a FileAppender to the given logger
 log4cxx::AppenderPtr logger_append_to_file(
     std::string const& filename, log4cxx::LoggerPtr logger = log4cxx::Logger::getRootLogger());
 
 /// adds a FileAppender to the given logger
+/// @arg json: Write one JSON object per line instead of plain text, see JSONLinesLayout
 log4cxx::AppenderPtr logger_write_to_file(
     std::string const& filename,
     bool append = false,
-    log4cxx::LoggerPtr logger = log4cxx::Logger::getRootLogger());
+    log4cxx::LoggerPtr logger = log4cxx::Logger::getRootLogger(),
+    bool json = false);
+
+/// adds an AsyncFileAppender to the given logger, writing the output of logger_write_to_file from
+/// a background thread through io_uring where available
+/// @throws std::system_error if the file cannot be opened
+log4cxx::AppenderPtr logger_write_to_file_async(
+    std::string const& filename,
+    bool append = false,
+    log4cxx::LoggerPtr logger = log4cxx::Logger::getRootLogger(),
+    bool json = false);
+
+/// adds a SharedMemoryAppender to the given logger, writing to the queue segment read by
+/// vislog_collector
+/// @arg name: Segment name, if empty logger::shm_default_name(), i.e. shared by all processes of
+/// the SLURM job
+/// @arg json: Pass JSON lines instead of plain text, see JSONLinesLayout
+log4cxx::AppenderPtr logger_write_to_shm(
+    std::string const& name = std::string(),
+    log4cxx::LoggerPtr logger = log4cxx::Logger::getRootLogger(),
+    bool json = false);
+
+/// Whether console output is colored: stdout is a terminal, checked once per process, and the
+/// library is not built with --disable-colorlog (CONFIG_NO_COLOR)
+bool logger_console_colors();
 
-/// adds a ConsoleAppender to the given logger
+/// adds a ConsoleAppender to the given logger, colored if logger_console_colors()
 log4cxx::AppenderPtr
 logger_write_to_cout(log4cxx::LoggerPtr logger = log4cxx::Logger::getRootLogger());
 
@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+ * @file reloadable_appender.h
+ *
+ * Appender forwarding events to the appenders of a properties file that can be replaced while
+ * other threads are logging, e.g. to raise the verbosity of a long-running experiment:
+ *     logger_watch_config("symap2ic_logger.conf");
+ *
+ * A reload configures a separate log4cxx::Hierarchy off to the side and publishes it with a single
+ * atomic pointer swap; logging threads never wait for a reload. Events already being appended keep
+ * the previous configuration alive, its appenders are closed by the reloading thread once the last
+ * of these events completed (RCU-style grace period). In contrast to
+ * PropertyConfigurator::configure, no appender is closed while an event might still use it.
+ *
+ * Levels of the loggers named in the file are applied to the live loggers, appenders and additivity
+ * are evaluated by the appender. Appenders of other loggers in the live hierarchy are unaffected.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <log4cxx/appenderskeleton.h>
+
+namespace log4cxx {
+
+class ReloadableAppender : public AppenderSkeleton
+{
+public:
+	/**
+	 * Load the configuration file.
+	 * @param watch Reload whenever the file is rewritten or replaced (inotify).
+	 * @throws std::runtime_error if the file does not exist, defines no appenders or cannot be
+	 *                            watched
+	 */
+	explicit ReloadableAppender(std::string const& filename, bool watch = true);
+
+	~ReloadableAppender() override;
+
+	/**
+	 * Stop watching and close the appenders of the current configuration.
+	 */
+	void close() override;
+
+	bool requiresLayout() const override
+	{
+		return false;
+	}
+
+	/**
+	 * Forward the event without taking the appender lock, the forwarded appenders serialize
+	 * themselves. Threshold and filters apply as for other appenders; filters have to be added
+	 * before events are appended.
+	 */
+	void doAppend(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool) override;
+
+	/**
+	 * Load the file again and publish it. Returns after the appenders of the previous
+	 * configuration were closed.
+	 * @throws std::runtime_error if the file does not exist or defines no appenders, the current
+	 *                            configuration is kept
+	 */
+	void reload();
+
+	/**
+	 * Number of configurations published so far.
+	 */
+	uint64_t generation() const;
+
+	std::string const& filename() const
+	{
+		return m_filename;
+	}
+
+protected:
+	void append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool) override;
+
+private:
+	struct Configuration;
+
+	static std::shared_ptr<Configuration const> load(std::string const& filename);
+	static void apply_levels(Configuration const& configuration, Configuration const* previous);
+	void publish(std::shared_ptr<Configuration const> configuration);
+	void watch();
+
+	std::string const m_filename;
+	/// accessed through std::atomic_load/std::atomic_store only
+	std::shared_ptr<Configuration const> m_configuration;
+	std::atomic<uint64_t> m_generation;
+
+	/// serializes reloads
+	std::mutex m_reload_mutex;
+	int m_inotify;
+	/// eventfd waking the watcher on close()
+	int m_stop;
+	std::thread m_watcher;
+};
+
+LOG4CXX_PTR_DEF(ReloadableAppender);
+
+} // namespace log4cxx
@@ -0,0 +1,167 @@
+#pragma once
+
+/**
+ * @file sampling.h
+ *
+ * Sampling macros for hot call sites producing many similar messages, e.g. TRACE/DEBUG output in
+ * inner loops:
+ *     LOG4CXX_DEBUG_EVERY_N(logger, 1000, "iteration " << i);
+ *     LOG4CXX_TRACE_PER_SECOND(logger, 10, "state " << state);
+ *
+ * Each call site keeps its own thread-local sampler, so there is no shared state between threads.
+ * The sampling decision is taken after the level check and before the message is formatted.
+ * Sampled messages are suffixed with the number of calls skipped since the previous one of the
+ * same thread, e.g. "iteration 2000 [999 skipped]".
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "logger/log4cxx/thread_level.h"
+
+namespace visionary_logger {
+
+/**
+ * Logs the first of every n calls.
+ */
+class EveryNSampler
+{
+public:
+	/**
+	 * @param skipped Set to the number of calls skipped since the last sample, if sampled.
+	 */
+	bool sample(uint64_t n, uint64_t& skipped)
+	{
+		if (m_countdown > 0) {
+			--m_countdown;
+			++m_skipped;
+			return false;
+		}
+		m_countdown = (n > 0) ? n - 1 : 0;
+		skipped = m_skipped;
+		m_skipped = 0;
+		return true;
+	}
+
+private:
+	uint64_t m_countdown = 0;
+	uint64_t m_skipped = 0;
+};
+
+/**
+ * Logs 1-in-n calls, adapting n to the call rate observed within the current second such that about
+ * `per_second` messages are logged per second. Once the budget of the current second is exhausted,
+ * further calls are skipped until the second is over, so bursts are cut off early. The clock is
+ * only read for every n-th call.
+ */
+class RateSampler
+{
+public:
+	/**
+	 * @param skipped Set to the number of calls skipped since the last sample, if sampled.
+	 */
+	bool sample(uint64_t per_second, uint64_t& skipped)
+	{
+		++m_window_calls;
+		if (m_countdown > 1) {
+			--m_countdown;
+			++m_skipped;
+			return false;
+		}
+		m_countdown = m_n;
+
+		int64_t const now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		                        std::chrono::steady_clock::now().time_since_epoch())
+		                        .count();
+		int64_t const elapsed = now - m_window_start;
+		if (elapsed >= window || m_window_logged >= per_second) {
+			// interval for per_second samples at the call rate observed in this window
+			double const rate = static_cast<double>(m_window_calls) * 1e9 /
+			                    static_cast<double>(std::max<int64_t>(elapsed, 1));
+			double const n = (per_second > 0) ? rate / static_cast<double>(per_second) : 1.;
+			m_n = (n > 1.) ? static_cast<uint64_t>(n + 0.5) : 1;
+			m_countdown = m_n;
+		}
+		if (elapsed >= window) {
+			m_window_start = now;
+			m_window_calls = 0;
+			m_window_logged = 0;
+		} else if (m_window_logged >= per_second) {
+			++m_skipped;
+			return false;
+		}
+
+		++m_window_logged;
+		skipped = m_skipped;
+		m_skipped = 0;
+		return true;
+	}
+
+private:
+	/// ns between adaptations of the sampling interval
+	static constexpr int64_t window = 1000000000;
+
+	uint64_t m_n = 1;
+	uint64_t m_countdown = 0;
+	uint64_t m_skipped = 0;
+	int64_t m_window_start = 0;
+	uint64_t m_window_calls = 0;
+	uint64_t m_window_logged = 0;
+};
+
+} // namespace visionary_logger
+
+#define VISIONARY_LOGGER_SAMPLED(logger, level, enabled, sampler_type, parameter, message)         \
+	{                                                                                              \
+		if (enabled) {                                                                             \
+			static thread_local sampler_type sampler_;                                             \
+			uint64_t skipped_;                                                                     \
+			if (sampler_.sample(parameter, skipped_)) {                                            \
+				::log4cxx::helpers::MessageBuffer oss_;                                            \
+				logger->forcedLog(                                                                 \
+				    level, oss_.str(oss_ << message << " [" << skipped_ << " skipped]"),           \
+				    LOG4CXX_LOCATION);                                                             \
+			}                                                                                      \
+		}                                                                                          \
+	}
+
+/// log the first of every n calls of this call site and thread
+#define LOG4CXX_LOG_EVERY_N(logger, level, n, message)                                             \
+	VISIONARY_LOGGER_SAMPLED(                                                                      \
+	    logger, level, visionary_logger::enabled_for(logger, level),                               \
+	    visionary_logger::EveryNSampler, n, message)
+
+/// log about per_second messages per second of this call site and thread
+#define LOG4CXX_LOG_PER_SECOND(logger, level, per_second, message)                                 \
+	VISIONARY_LOGGER_SAMPLED(                                                                      \
+	    logger, level, visionary_logger::enabled_for(logger, level),                               \
+	    visionary_logger::RateSampler, per_second, message)
+
+#define LOG4CXX_TRACE_EVERY_N(logger, n, message)                                                  \
+	VISIONARY_LOGGER_SAMPLED(                                                                      \
+	    logger, ::log4cxx::Level::getTrace(),                                                      \
+	    VISIONARY_LOGGER_ENABLED(                                                                  \
+	        ::log4cxx::Level::TRACE_INT, LOG4CXX_UNLIKELY(logger->isTraceEnabled())),              \
+	    visionary_logger::EveryNSampler, n, message)
+
+#define LOG4CXX_DEBUG_EVERY_N(logger, n, message)                                                  \
+	VISIONARY_LOGGER_SAMPLED(                                                                      \
+	    logger, ::log4cxx::Level::getDebug(),                                                      \
+	    VISIONARY_LOGGER_ENABLED(                                                                  \
+	        ::log4cxx::Level::DEBUG_INT, LOG4CXX_UNLIKELY(logger->isDebugEnabled())),              \
+	    visionary_logger::EveryNSampler, n, message)
+
+#define LOG4CXX_TRACE_PER_SECOND(logger, per_second, message)                                      \
+	VISIONARY_LOGGER_SAMPLED(                                                                      \
+	    logger, ::log4cxx::Level::getTrace(),                                                      \
+	    VISIONARY_LOGGER_ENABLED(                                                                  \
+	        ::log4cxx::Level::TRACE_INT, LOG4CXX_UNLIKELY(logger->isTraceEnabled())),              \
+	    visionary_logger::RateSampler, per_second, message)
+
+#define LOG4CXX_DEBUG_PER_SECOND(logger, per_second, message)                                      \
+	VISIONARY_LOGGER_SAMPLED(                                                                      \
+	    logger, ::log4cxx::Level::getDebug(),                                                      \
+	    VISIONARY_LOGGER_ENABLED(                                                                  \
+	        ::log4cxx::Level::DEBUG_INT, LOG4CXX_UNLIKELY(logger->isDebugEnabled())),              \
+	    visionary_logger::RateSampler, per_second, message)
@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * @file shm_appender.h
+ *
+ * Appender passing formatted events to a collector process through a shared-memory queue instead
+ * of writing a file per process, cf. logger/shm_queue.h. Run one collector per machine,
+ *     vislog_collector -o job.log
+ * and attach the appender in every process:
+ *     logger_write_to_shm();
+ *
+ * Appending never blocks: if the collector falls behind and the queue is full, events are dropped
+ * and the collector reports their number.
+ */
+
+#include <memory>
+#include <string>
+
+#include <log4cxx/appenderskeleton.h>
+
+#include "logger/shm_queue.h"
+
+namespace log4cxx {
+
+class SharedMemoryAppender : public AppenderSkeleton
+{
+public:
+	/**
+	 * Create or attach to the queue segment, see logger::ShmQueue.
+	 * @throws std::system_error if the segment cannot be created or attached
+	 */
+	SharedMemoryAppender(
+	    LayoutPtr const& layout,
+	    std::string const& name = logger::shm_default_name(),
+	    size_t capacity = 4096,
+	    size_t record_size = 4096);
+
+	~SharedMemoryAppender() override;
+
+	void close() override;
+
+	bool requiresLayout() const override
+	{
+		return true;
+	}
+
+	/**
+	 * Number of events dropped by all producers of the segment because the queue was full.
+	 */
+	uint64_t dropped() const;
+
+protected:
+	void append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool) override;
+
+private:
+	std::unique_ptr<logger::ShmQueue> m_queue;
+	/// formatting buffer, appending is serialized by AppenderSkeleton
+	LogString m_buffer;
+};
+
+LOG4CXX_PTR_DEF(SharedMemoryAppender);
+
+} // namespace log4cxx
@@ -0,0 +1,86 @@
+#pragma once
+
+/**
+ * @file thread_level.h
+ *
+ * Scoped per-thread level overrides, e.g. to enable DEBUG output for a single request or worker
+ * thread without enabling it everywhere else:
+ *     {
+ *         visionary_logger::ScopedLevel debug(log4cxx::Level::getDebug());
+ *         handle(request);
+ *     }
+ * While an override is active, it replaces the levels of all loggers for the LOG4CXX_* macros and
+ * the stream API of the calling thread; other threads are not affected. Overrides nest, the
+ * innermost one wins. Without an override, the check costs one thread-local load on top of the
+ * usual level check.
+ */
+
+#include <log4cxx/level.h>
+#include <log4cxx/logger.h>
+
+namespace visionary_logger {
+
+namespace detail {
+
+/// innermost override of the calling thread, nullptr if none
+inline thread_local log4cxx::Level const* thread_level = nullptr;
+
+} // namespace detail
+
+/**
+ * Override the levels of all loggers in the calling thread for the lifetime of this object.
+ */
+class ScopedLevel
+{
+public:
+	explicit ScopedLevel(log4cxx::LevelPtr level) :
+	    m_level(std::move(level)), m_previous(detail::thread_level)
+	{
+		detail::thread_level = m_level.get();
+	}
+
+	~ScopedLevel()
+	{
+		detail::thread_level = m_previous;
+	}
+
+	ScopedLevel(ScopedLevel const&) = delete;
+	ScopedLevel& operator=(ScopedLevel const&) = delete;
+
+	// overrides are bound to scopes
+	static void* operator new(size_t) = delete;
+	static void* operator new[](size_t) = delete;
+
+private:
+	log4cxx::LevelPtr m_level;
+	log4cxx::Level const* m_previous;
+};
+
+/**
+ * Level override of the calling thread, nullptr if none.
+ */
+inline log4cxx::Level const* thread_level()
+{
+	return detail::thread_level;
+}
+
+/**
+ * Whether logger logs level in the calling thread, honoring ScopedLevel.
+ */
+template <typename LoggerT>
+inline bool enabled_for(LoggerT const& logger, log4cxx::LevelPtr const& level)
+{
+	log4cxx::Level const* const override_level = detail::thread_level;
+	if (!LOG4CXX_UNLIKELY(override_level != nullptr)) {
+		return logger->isEnabledFor(level);
+	}
+	return level->toInt() >= override_level->toInt();
+}
+
+} // namespace visionary_logger
+
+/// level check of the LOG4CXX_* macros, `enabled` is the logger's own check
+#define VISIONARY_LOGGER_ENABLED(level_int, enabled)                                               \
+	(!LOG4CXX_UNLIKELY(visionary_logger::detail::thread_level != nullptr)                          \
+	     ? (enabled)                                                                               \
+	     : ((level_int) >= visionary_logger::detail::thread_level->toInt()))
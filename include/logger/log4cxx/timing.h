@@ -0,0 +1,216 @@
+#pragma once
+
+/**
+ * @file timing.h
+ *
+ * Scoped timers collecting durations into per-thread latency histograms and logging periodic
+ * percentile summaries instead of one line per measurement:
+ *     static visionary_logger::LatencyTimer timer(logger, "experiment.run");
+ *     {
+ *         visionary_logger::ScopedTimer scope(timer);
+ *         ...
+ *     }
+ * or shorter
+ *     LOG4CXX_SCOPED_TIMER(logger, "experiment.run");
+ * logs e.g. every 10 s
+ *     timer experiment.run: n=8192 p50=1.21ms p99=2.05ms max=3.11ms
+ *
+ * Durations are measured in TSC ticks on x86 (assuming an invariant TSC, as on all recent CPUs)
+ * and in steady_clock nanoseconds elsewhere. Ticks are converted when summaries are logged.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <log4cxx/level.h>
+#include <log4cxx/logger.h>
+
+namespace visionary_logger {
+
+/**
+ * Current time in ticks, cf. ticks_per_ns().
+ */
+inline uint64_t timer_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	           std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+#endif
+}
+
+/**
+ * Tick rate, calibrated against steady_clock since the first call.
+ */
+double ticks_per_ns();
+
+/**
+ * Log-linear histogram of durations in ticks with a relative bucket width of at most 1/16 (as in
+ * HdrHistogram). Recorded by a single thread, readable from any thread.
+ */
+class LatencyHistogram
+{
+public:
+	/// values below are counted exactly
+	static constexpr size_t linear = 32;
+	static constexpr size_t buckets = linear + (64 - 5) * (linear / 2);
+
+	static size_t index(uint64_t value)
+	{
+		if (value < linear) {
+			return static_cast<size_t>(value);
+		}
+		unsigned const exponent = 63 - __builtin_clzll(value);
+		unsigned const shift = exponent - 4;
+		return linear + (exponent - 5) * (linear / 2) + ((value >> shift) - linear / 2);
+	}
+
+	/**
+	 * Largest value counted in the bucket.
+	 */
+	static uint64_t upper_bound(size_t index)
+	{
+		if (index < linear) {
+			return index;
+		}
+		size_t const exponent = (index - linear) / (linear / 2) + 5;
+		uint64_t const mantissa = (index - linear) % (linear / 2) + linear / 2;
+		unsigned const shift = exponent - 4;
+		return ((mantissa + 1) << shift) - 1;
+	}
+
+	void record(uint64_t value)
+	{
+		std::atomic<uint64_t>& count = m_counts[index(value)];
+		// single writer, no read-modify-write needed
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Number of values recorded in the bucket since construction.
+	 */
+	uint64_t count(size_t index) const
+	{
+		return m_counts[index].load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t> m_counts[buckets] = {};
+};
+
+/**
+ * Named timer attached to a logger, collecting durations of all threads and logging a summary of
+ * the durations recorded since the previous summary once per period. Summaries are logged by the
+ * thread recording the first duration after the period elapsed.
+ */
+class LatencyTimer
+{
+public:
+	struct Summary
+	{
+		uint64_t count;
+		double p50_ns;
+		double p99_ns;
+		double max_ns;
+	};
+
+	LatencyTimer(
+	    log4cxx::LoggerPtr logger,
+	    std::string name,
+	    std::chrono::milliseconds period = std::chrono::seconds(10),
+	    log4cxx::LevelPtr level = log4cxx::Level::getInfo());
+
+	~LatencyTimer();
+
+	LatencyTimer(LatencyTimer const&) = delete;
+	LatencyTimer& operator=(LatencyTimer const&) = delete;
+
+	/**
+	 * Add a duration to the calling thread's histogram and log a summary if the period elapsed.
+	 */
+	void record(uint64_t ticks)
+	{
+		local().record(ticks);
+		if (m_next_report.load(std::memory_order_relaxed) <= timer_ticks()) {
+			report_if_due();
+		}
+	}
+
+	/**
+	 * Summary of the durations recorded since the previous summary, i.e. resets the summary.
+	 */
+	Summary summary();
+
+	/**
+	 * Log summary() now, e.g. at the end of an experiment. Nothing is logged if no durations were
+	 * recorded.
+	 */
+	void report();
+
+	std::string const& name() const
+	{
+		return m_name;
+	}
+
+private:
+	LatencyHistogram& local();
+	void report_if_due();
+
+	log4cxx::LoggerPtr m_logger;
+	std::string m_name;
+	log4cxx::LevelPtr m_level;
+	uint64_t const m_id;
+	uint64_t m_period_ticks;
+	std::atomic<uint64_t> m_next_report;
+
+	/// guards m_histograms and m_reported
+	std::mutex m_mutex;
+	std::vector<std::shared_ptr<LatencyHistogram>> m_histograms;
+	/// sum of all histograms at the previous summary
+	std::vector<uint64_t> m_reported;
+};
+
+/**
+ * Records the lifetime of the scope into the timer.
+ */
+class ScopedTimer
+{
+public:
+	explicit ScopedTimer(LatencyTimer& timer) : m_timer(timer), m_start(timer_ticks()) {}
+
+	~ScopedTimer()
+	{
+		m_timer.record(timer_ticks() - m_start);
+	}
+
+	ScopedTimer(ScopedTimer const&) = delete;
+	ScopedTimer& operator=(ScopedTimer const&) = delete;
+
+private:
+	LatencyTimer& m_timer;
+	uint64_t const m_start;
+};
+
+} // namespace visionary_logger
+
+#define VISIONARY_LOGGER_CONCAT_(a, b) a##b
+#define VISIONARY_LOGGER_CONCAT(a, b) VISIONARY_LOGGER_CONCAT_(a, b)
+
+/// time the rest of the enclosing scope, the timer is created with the logger and name of the
+/// first execution
+#define LOG4CXX_SCOPED_TIMER(logger, name)                                                         \
+	static visionary_logger::LatencyTimer VISIONARY_LOGGER_CONCAT(timer_, __LINE__)(logger, name); \
+	visionary_logger::ScopedTimer VISIONARY_LOGGER_CONCAT(scoped_timer_, __LINE__)(                \
+	    VISIONARY_LOGGER_CONCAT(timer_, __LINE__))
@@ -0,0 +1,310 @@
+#pragma once
+
+/**
+ * @file shm_queue.h
+ *
+ * Bounded lock-free multi-producer queue of log records in a POSIX shared-memory segment, used to
+ * funnel the log output of many processes on one machine, e.g. all ranks of a SLURM job, into a
+ * single collector process writing one file (see log4cxx::SharedMemoryAppender and
+ * vislog_collector).
+ *
+ * The segment is created by whichever side opens it first and never resized; producers and the
+ * collector may be started in any order. Producers never block, records pushed to a full queue
+ * are dropped and counted in the segment.
+ */
+
+extern "C" {
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+
+namespace logger {
+
+/**
+ * Default segment name, shared by all processes of the current SLURM job or, outside of SLURM,
+ * by all processes of the current user.
+ */
+inline std::string shm_default_name()
+{
+	char const* jobid = std::getenv("SLURM_JOBID");
+	if (jobid && *jobid) {
+		return std::string("/vislog-job-") + jobid;
+	}
+	return "/vislog-uid-" + std::to_string(getuid());
+}
+
+/**
+ * Queue of records in a shared-memory segment (D. Vyukov's bounded MPMC queue with all state
+ * inside the segment), consumed by a single collector.
+ */
+class ShmQueue
+{
+public:
+	/// record flag: the record was truncated to the slot size
+	static constexpr uint32_t truncated = 1;
+
+	struct Record
+	{
+		std::atomic<uint64_t> sequence;
+		uint32_t size;
+		uint32_t flags;
+		/// process writing the claimed record, 0 while unclaimed or not yet published
+		std::atomic<int32_t> owner;
+
+		/// payload follows the record header
+		char* data()
+		{
+			return reinterpret_cast<char*>(this + 1);
+		}
+
+		char const* data() const
+		{
+			return reinterpret_cast<char const*>(this + 1);
+		}
+	};
+
+	/**
+	 * Create the segment or attach to an existing one, whose geometry then takes precedence.
+	 * @param name Segment name as for shm_open(), e.g. shm_default_name().
+	 * @param capacity Number of records, rounded up to a power of two.
+	 * @param record_size Maximum size of records, longer ones are truncated.
+	 * @throws std::system_error if the segment cannot be created or attached
+	 */
+	ShmQueue(std::string const& name, size_t capacity = 4096, size_t record_size = 4096) :
+	    m_name(name), m_header(nullptr), m_size(0), m_pid(getpid())
+	{
+		size_t slots = 2;
+		while (slots < capacity) {
+			slots *= 2;
+		}
+		size_t const stride = slot_stride(record_size);
+
+		bool created = true;
+		int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd < 0 && errno == EEXIST) {
+			created = false;
+			fd = shm_open(name.c_str(), O_RDWR, 0600);
+		}
+		if (fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+		}
+
+		if (created) {
+			m_size = sizeof(Header) + slots * stride;
+			if (ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+				int const error = errno;
+				close(fd);
+				shm_unlink(name.c_str());
+				throw std::system_error(error, std::generic_category(), "ftruncate " + name);
+			}
+		} else {
+			// the creator may not have sized the segment yet
+			struct stat st;
+			for (int i = 0; (fstat(fd, &st) == 0) && (st.st_size == 0) && (i < 1000); ++i) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			m_size = static_cast<size_t>(st.st_size);
+			if (m_size < sizeof(Header)) {
+				close(fd);
+				throw std::system_error(EINVAL, std::generic_category(), "attach " + name);
+			}
+		}
+
+		void* memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		int const error = errno;
+		close(fd);
+		if (memory == MAP_FAILED) {
+			throw std::system_error(error, std::generic_category(), "mmap " + name);
+		}
+		m_header = static_cast<Header*>(memory);
+
+		if (created) {
+			// fresh segments are zero-filled
+			m_header->mask = slots - 1;
+			m_header->stride = stride;
+			for (size_t i = 0; i < slots; ++i) {
+				record(i).sequence.store(i, std::memory_order_relaxed);
+			}
+			m_header->magic.store(magic, std::memory_order_release);
+		} else {
+			for (int i = 0; (m_header->magic.load(std::memory_order_acquire) != magic) && (i < 1000);
+			     ++i) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			if ((m_header->magic.load(std::memory_order_acquire) != magic) ||
+			    (sizeof(Header) + (m_header->mask + 1) * m_header->stride != m_size)) {
+				munmap(m_header, m_size);
+				throw std::system_error(EINVAL, std::generic_category(), "attach " + name);
+			}
+		}
+	}
+
+	~ShmQueue()
+	{
+		if (m_header) {
+			munmap(m_header, m_size);
+		}
+	}
+
+	ShmQueue(ShmQueue const&) = delete;
+	ShmQueue& operator=(ShmQueue const&) = delete;
+
+	/**
+	 * Remove the segment name, attached processes keep their mapping.
+	 */
+	static void unlink(std::string const& name)
+	{
+		shm_unlink(name.c_str());
+	}
+
+	std::string const& name() const
+	{
+		return m_name;
+	}
+
+	size_t capacity() const
+	{
+		return m_header->mask + 1;
+	}
+
+	size_t record_size() const
+	{
+		return m_header->stride - sizeof(Record);
+	}
+
+	/**
+	 * Copy data into the queue as one record, truncated to record_size().
+	 * @return false if the queue is full, the record is then counted as dropped.
+	 */
+	bool try_push(char const* data, size_t size)
+	{
+		Record* slot;
+		uint64_t pos = m_header->enqueue_pos.load(std::memory_order_relaxed);
+		while (true) {
+			slot = &record(pos);
+			uint64_t const sequence = slot->sequence.load(std::memory_order_acquire);
+			int64_t const diff = static_cast<int64_t>(sequence - pos);
+			if (diff == 0) {
+				if (m_header->enqueue_pos.compare_exchange_weak(
+				        pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			} else {
+				pos = m_header->enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->owner.store(m_pid, std::memory_order_relaxed);
+		size_t const max_size = record_size();
+		slot->flags = (size > max_size) ? truncated : 0;
+		slot->size = static_cast<uint32_t>(std::min(size, max_size));
+		std::memcpy(slot->data(), data, slot->size);
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Oldest record or nullptr if empty, to be released by pop() after use. Single consumer only.
+	 */
+	Record const* front() const
+	{
+		uint64_t const pos = m_header->dequeue_pos.load(std::memory_order_relaxed);
+		Record const* slot = &record(pos);
+		return (slot->sequence.load(std::memory_order_acquire) == pos + 1) ? slot : nullptr;
+	}
+
+	void pop()
+	{
+		uint64_t const pos = m_header->dequeue_pos.load(std::memory_order_relaxed);
+		record(pos).owner.store(0, std::memory_order_relaxed);
+		record(pos).sequence.store(pos + m_header->mask + 1, std::memory_order_release);
+		m_header->dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Whether the oldest slot was claimed by a producer that has not finished writing it yet, e.g.
+	 * because it is preempted, stopped or was killed.
+	 */
+	bool pending() const
+	{
+		return !front() && (m_header->enqueue_pos.load(std::memory_order_relaxed) !=
+		                    m_header->dequeue_pos.load(std::memory_order_relaxed));
+	}
+
+	/**
+	 * Whether the oldest slot is pending and its producer no longer exists, so that it is never
+	 * finished and the collector has to skip it by pop(). Producers that are merely stopped (e.g.
+	 * SIGSTOP) or preempted still exist; skipping their slot would let them overwrite a later
+	 * record. A producer killed between claiming the slot and publishing its PID is not detected.
+	 * PIDs are compared within the collector's PID namespace.
+	 */
+	bool abandoned() const
+	{
+		if (!pending()) {
+			return false;
+		}
+		uint64_t const pos = m_header->dequeue_pos.load(std::memory_order_relaxed);
+		pid_t const owner = record(pos).owner.load(std::memory_order_relaxed);
+		return (owner != 0) && (kill(owner, 0) != 0) && (errno == ESRCH);
+	}
+
+	/**
+	 * Number of records dropped because the queue was full, since creation of the segment.
+	 */
+	uint64_t dropped() const
+	{
+		return m_header->dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	static constexpr uint64_t magic = 0x76697332'6f677368; // "vis2oghs"
+
+	struct Header
+	{
+		std::atomic<uint64_t> magic;
+		uint64_t mask;
+		uint64_t stride;
+		alignas(64) std::atomic<uint64_t> enqueue_pos;
+		alignas(64) std::atomic<uint64_t> dequeue_pos;
+		alignas(64) std::atomic<uint64_t> dropped;
+	};
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "queue must be address-free");
+
+	static size_t slot_stride(size_t record_size)
+	{
+		// keep slots on separate cache lines
+		return (sizeof(Record) + record_size + 63) & ~size_t(63);
+	}
+
+	Record& record(uint64_t pos) const
+	{
+		char* slots = reinterpret_cast<char*>(m_header) + sizeof(Header);
+		return *reinterpret_cast<Record*>(slots + (pos & m_header->mask) * m_header->stride);
+	}
+
+	std::string m_name;
+	Header* m_header;
+	size_t m_size;
+	/// getpid() is a system call, forked children attach their own queue
+	pid_t const m_pid;
+};
+
+} // namespace logger
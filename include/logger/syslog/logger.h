@@ -1,9 +1,37 @@
+#pragma once
 #include <syslog.h>
 
+extern "C" {
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+}
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <sstream>
+#include <streambuf>
 #include <string>
+#include <thread>
 #include <utility>
 
+#include "logger/fields.h"
+#include "logger/fixed_stream.h"
 
 namespace logger {
 
@@ -23,8 +51,76 @@ constexpr LogPriority prio_syslog_threshold = SYSLOG_THRESHOLD;
 constexpr LogPriority prio_syslog_threshold = LogPriority::INFO;
 #endif
 
+/**
+ * Initial runtime threshold. Messages have to pass both the compile-time threshold above and the
+ * runtime threshold, so e.g. DEBUG can be compiled in while only enabled on demand, see
+ * syslog_set_threshold().
+ */
+#ifdef SYSLOG_RUNTIME_THRESHOLD
+constexpr LogPriority prio_syslog_runtime_threshold = SYSLOG_RUNTIME_THRESHOLD;
+#else
+constexpr LogPriority prio_syslog_runtime_threshold = prio_syslog_threshold;
+#endif
+
+/**
+ * Size of the per-thread buffer a message is formatted into by the native syslog client. Longer
+ * messages are truncated.
+ */
+#ifndef LOGGER_SYSLOG_BUFFER_SIZE
+#define LOGGER_SYSLOG_BUFFER_SIZE 8192
+#endif
+
+/**
+ * Maximum size of a record, header included, queued for the asynchronous sender. Longer records
+ * are truncated.
+ */
+#ifndef LOGGER_SYSLOG_ASYNC_RECORD_SIZE
+#define LOGGER_SYSLOG_ASYNC_RECORD_SIZE 2048
+#endif
+
 namespace detail {
 
+/**
+ * Current runtime threshold, written from signal handlers as well. Shared by all translation units,
+ * which may define different SYSLOG_RUNTIME_THRESHOLD, so it starts fully open, leaving messages to
+ * the compile-time threshold until syslog_open() or syslog_set_threshold() sets it.
+ */
+inline std::atomic<int> syslog_runtime_threshold{static_cast<int>(LogPriority::DEBUG)};
+
+/// runtime threshold restored by the next signal, see syslog_threshold_signal()
+inline std::atomic<int> syslog_saved_threshold{static_cast<int>(LogPriority::DEBUG)};
+
+/// whether the runtime threshold was set by syslog_open() or syslog_set_threshold()
+inline std::atomic<bool> syslog_threshold_configured{false};
+
+/**
+ * Whether messages of given priority pass the runtime threshold, one relaxed load.
+ */
+inline bool syslog_enabled(LogPriority prio)
+{
+	return static_cast<int>(prio) <= syslog_runtime_threshold.load(std::memory_order_relaxed);
+}
+
+/**
+ * Parse priority name, case-insensitive, e.g. "debug" or "WARN".
+ * @return false if the name is unknown.
+ */
+inline bool prio_from_string(char const* name, LogPriority& prio)
+{
+	static std::pair<char const*, LogPriority> const names[] = {
+	    {"DEBUG", LogPriority::DEBUG},  {"INFO", LogPriority::INFO},
+	    {"WARN", LogPriority::WARN},    {"WARNING", LogPriority::WARN},
+	    {"ERROR", LogPriority::ERROR},  {"CRIT", LogPriority::CRIT},
+	    {"CRITICAL", LogPriority::CRIT}, {"NONE", LogPriority::NONE}};
+	for (auto const& entry : names) {
+		if (strcasecmp(name, entry.first) == 0) {
+			prio = entry.second;
+			return true;
+		}
+	}
+	return false;
+}
+
 /**
  * Return string that reflects given logging priority.
  * @param prio Logging priority.
@@ -48,20 +144,640 @@ constexpr char const* prio_to_string(LogPriority prio)
 	}
 }
 
+/**
+ * Append RFC 5424 STRUCTURED-DATA followed by a space: one element with the static fields and the
+ * given fields, "-" if there are none. A FixedOutput running out of space drops the parameters not
+ * fitting completely, so the element stays well-formed.
+ */
+template <typename Output>
+void append_structured_data(Output& out, Fields fields)
+{
+	StaticFields::Snapshot const& static_fields = StaticFields::instance().get();
+	if (static_fields.fields.empty() && fields.empty()) {
+		append(out, "- ");
+		return;
+	}
+
+	char const terminator[] = "] ";
+	size_t const reserved = sizeof(terminator) - 1;
+	auto const append_complete = [&](auto const& append_params) {
+		if constexpr (std::is_same_v<Output, FixedOutput>) {
+			size_t const size = out.size();
+			append_params();
+			if (out.size() + reserved > out.capacity()) {
+				out.resize(size);
+				return false;
+			}
+		} else {
+			append_params();
+		}
+		return true;
+	};
+
+	append(out, "[" LOGGER_FIELDS_SD_ID);
+	if (append_complete([&] { append(out, static_fields.sd_params); })) {
+		for (Field const& field : fields) {
+			if (!append_complete([&] { append_sd_params(out, Fields(&field, 1)); })) {
+				break;
+			}
+		}
+	}
+	append(out, terminator);
+}
+
+/**
+ * Per-thread message stream of the native syslog client, formats into a fixed buffer without
+ * allocating. Must not be used recursively, i.e. the streamed message must not itself log to
+ * syslog.
+ */
+class SyslogStream
+{
+public:
+	SyslogStream() : m_stream(&m_buffer) {}
+
+	static SyslogStream& local()
+	{
+		thread_local SyslogStream stream;
+		return stream;
+	}
+
+	/**
+	 * Start a new message, prefixed by the given priority tag.
+	 */
+	std::ostream& begin(LogPriority prio)
+	{
+		m_buffer.reset(m_data, m_data + sizeof(m_data));
+		reset_stream(m_stream);
+		m_stream << '[' << prio_to_string(prio) << "] ";
+		return m_stream;
+	}
+
+	char const* data() const
+	{
+		return m_data;
+	}
+
+	size_t size() const
+	{
+		return m_buffer.size();
+	}
+
+private:
+	char m_data[LOGGER_SYSLOG_BUFFER_SIZE];
+	FixedStreamBuffer m_buffer;
+	std::ostream m_stream;
+};
+
+/**
+ * Bounded lock-free multi-producer queue of preformatted syslog records (D. Vyukov's bounded MPMC
+ * queue), consumed by a single sender thread. Producers never block, pushing to a full queue fails.
+ */
+class SyslogQueue
+{
+public:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		size_t size;
+		char data[LOGGER_SYSLOG_ASYNC_RECORD_SIZE];
+	};
+
+	/**
+	 * @param capacity Number of records, rounded up to a power of two.
+	 */
+	explicit SyslogQueue(size_t capacity) : m_enqueue_pos(0), m_dequeue_pos(0)
+	{
+		size_t size = 2;
+		while (size < capacity) {
+			size *= 2;
+		}
+		m_mask = size - 1;
+		m_slots.reset(new Slot[size]);
+		for (size_t i = 0; i < size; ++i) {
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * Copy header and message into the queue as one record.
+	 * @return false if the queue is full.
+	 */
+	bool try_push(char const* header, size_t header_size, char const* message, size_t size)
+	{
+		Slot* slot;
+		size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+		while (true) {
+			slot = &m_slots[pos & m_mask];
+			size_t const sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t const diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if (diff == 0) {
+				if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false;
+			} else {
+				pos = m_enqueue_pos.load(std::memory_order_relaxed);
+			}
+		}
+
+		header_size = std::min(header_size, sizeof(slot->data));
+		size = std::min(size, sizeof(slot->data) - header_size);
+		std::memcpy(slot->data, header, header_size);
+		std::memcpy(slot->data + header_size, message, size);
+		slot->size = header_size + size;
+		slot->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Oldest record or nullptr if empty, to be released by pop() after use. Single consumer only.
+	 */
+	Slot const* front() const
+	{
+		size_t const pos = m_dequeue_pos.load(std::memory_order_relaxed);
+		Slot const* slot = &m_slots[pos & m_mask];
+		return (slot->sequence.load(std::memory_order_acquire) == pos + 1) ? slot : nullptr;
+	}
+
+	void pop()
+	{
+		size_t const pos = m_dequeue_pos.load(std::memory_order_relaxed);
+		m_slots[pos & m_mask].sequence.store(pos + m_mask + 1, std::memory_order_release);
+		m_dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+	}
+
+private:
+	std::unique_ptr<Slot[]> m_slots;
+	size_t m_mask;
+	alignas(64) std::atomic<size_t> m_enqueue_pos;
+	alignas(64) std::atomic<size_t> m_dequeue_pos;
+};
+
+/**
+ * Syslog client speaking RFC 5424 over a persistent datagram connection to the local syslog
+ * socket, bypassing libc's syslog(), which takes a global lock, formats via vsnprintf and may
+ * reconnect for every message.
+ *
+ * The connection is established lazily on the first message and re-established transparently
+ * when the syslog daemon was restarted. Reconnecting and closing replace the socket behind the same
+ * file descriptor, so concurrent senders never use a stale descriptor; the descriptor stays
+ * reserved once connected.
+ *
+ * Optionally, records are handed to a dedicated sender thread through a bounded lock-free queue,
+ * so a slow or rate-limiting syslog daemon never blocks the logging threads. Records that do not
+ * fit into the queue or cannot be delivered are dropped and counted.
+ */
+class SyslogClient
+{
+public:
+	static SyslogClient& instance()
+	{
+		// leaked on purpose, messages may be logged during static destruction
+		static SyslogClient* client = new SyslogClient;
+		return *client;
+	}
+
+	/**
+	 * Set parameters used for all subsequent messages, cf. openlog(3). Cheap if called again with
+	 * unchanged parameters.
+	 * @param ident Identifier, APP-NAME of the records.
+	 * @param option Syslog options, LOG_PERROR additionally writes messages to stderr.
+	 * @param facility Syslog facility.
+	 * @param socket_path Path of the syslog socket, nullptr keeps the current one ("/dev/log" by
+	 * default).
+	 */
+	void open(char const* ident, int option, int facility, char const* socket_path)
+	{
+		std::string const app_name = (ident && *ident) ? ident : "-";
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (socket_path && m_socket_path != socket_path) {
+			m_socket_path = socket_path;
+			disconnect();
+		}
+
+		Identity const* current = m_identity.load(std::memory_order_relaxed);
+		if (current->app_name == app_name && current->option == option &&
+		    current->facility == facility) {
+			return;
+		}
+		// Senders may still read the current identity, it is leaked on purpose. Switching between
+		// different identities is expected to be rare.
+		m_identity.store(new Identity(app_name, option, facility), std::memory_order_release);
+	}
+
+	/**
+	 * Close the connection to the syslog daemon, the next message reconnects.
+	 */
+	void close()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		disconnect();
+	}
+
+	/**
+	 * Send message with given priority and fields as one record.
+	 */
+	void send(LogPriority prio, char const* message, size_t size, Fields fields = Fields())
+	{
+		char header[header_capacity];
+		size_t const header_size = format_header(prio, header, sizeof(header), fields);
+
+		if (m_async_enabled.load(std::memory_order_acquire)) {
+			if (m_async->queue.try_push(header, header_size, message, size)) {
+				if (m_async->sleeping.load(std::memory_order_acquire)) {
+					m_async->wakeup.notify_one();
+				}
+				// stop_async() may have drained the queue before the push
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (!m_async_enabled.load(std::memory_order_relaxed)) {
+					std::lock_guard<std::mutex> lock(m_async_mutex);
+					if (!m_async_enabled.load()) {
+						drain();
+					}
+				}
+			} else {
+				m_async->dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+		} else {
+			send_record(header, header_size, message, size, 0);
+		}
+
+		if (m_identity.load(std::memory_order_acquire)->option & LOG_PERROR) {
+			struct iovec iov[2];
+			iov[0].iov_base = const_cast<char*>(message);
+			iov[0].iov_len = size;
+			iov[1].iov_base = const_cast<char*>("\n");
+			iov[1].iov_len = 1;
+			ssize_t ret = writev(STDERR_FILENO, iov, 2);
+			static_cast<void>(ret);
+		}
+	}
+
+	/**
+	 * Start sending records from a dedicated thread. Subsequent messages are queued without
+	 * blocking and sent with MSG_DONTWAIT.
+	 * @param capacity Number of records the queue holds, see also LOGGER_SYSLOG_ASYNC_RECORD_SIZE.
+	 * Only effective on the first start.
+	 */
+	void start_async(size_t capacity)
+	{
+		std::lock_guard<std::mutex> lock(m_async_mutex);
+		if (m_async_enabled.load()) {
+			return;
+		}
+		if (!m_async) {
+			// leaked on purpose, producers may still hold it after stop_async()
+			m_async = new AsyncState(capacity);
+			std::atexit([] { SyslogClient::instance().stop_async(); });
+		}
+		m_async->stop.store(false);
+		m_async->thread = std::thread([this] { run_async(); });
+		m_async_enabled.store(true, std::memory_order_release);
+	}
+
+	/**
+	 * Send all queued records and stop the sender thread, subsequent messages are sent
+	 * synchronously again.
+	 */
+	void stop_async()
+	{
+		std::lock_guard<std::mutex> lock(m_async_mutex);
+		if (!m_async_enabled.load()) {
+			return;
+		}
+		m_async_enabled.store(false);
+		m_async->stop.store(true);
+		m_async->wakeup.notify_one();
+		m_async->thread.join();
+		// records pushed by producers which saw the sender still enabled
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		drain();
+	}
+
+	bool async_enabled() const
+	{
+		return m_async_enabled.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * Number of records dropped by the asynchronous sender, because the queue was full or the
+	 * syslog daemon did not accept them.
+	 */
+	size_t dropped() const
+	{
+		return m_async ? m_async->dropped.load(std::memory_order_relaxed) : 0;
+	}
+
+	/**
+	 * Send the message formatted into the calling thread's SyslogStream.
+	 */
+	void send(LogPriority prio, SyslogStream const& stream, Fields fields = Fields())
+	{
+		send(prio, stream.data(), stream.size(), fields);
+	}
+
+private:
+	/**
+	 * Immutable per-process part of the records.
+	 */
+	struct Identity
+	{
+		Identity(std::string const& app_name, int option, int facility) :
+		    app_name(app_name), option(option), facility(facility)
+		{
+			char hostname[256];
+			if (gethostname(hostname, sizeof(hostname)) == 0) {
+				hostname[sizeof(hostname) - 1] = '\0';
+			} else {
+				std::strcpy(hostname, "-");
+			}
+			// HOSTNAME APP-NAME PROCID MSGID
+			fields = std::string(hostname) + " " + app_name + " " + std::to_string(getpid()) + " - ";
+		}
+
+		std::string const app_name;
+		int const option;
+		int const facility;
+		std::string fields;
+	};
+
+	/**
+	 * Queue and sender thread of the asynchronous mode.
+	 */
+	struct AsyncState
+	{
+		explicit AsyncState(size_t capacity) :
+		    queue(capacity), dropped(0), reported(0), stop(false), sleeping(false)
+		{}
+
+		SyslogQueue queue;
+		std::atomic<size_t> dropped;
+		size_t reported;
+		std::atomic<bool> stop;
+		std::atomic<bool> sleeping;
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		std::thread thread;
+	};
+
+	SyslogClient() :
+	    m_fd(-1),
+	    m_identity(new Identity(program_invocation_short_name, 0, LOG_USER)),
+	    m_socket_path("/dev/log"),
+	    m_async_enabled(false),
+	    m_async(nullptr)
+	{}
+
+	/**
+	 * Send header and message as one datagram, reconnecting once if the daemon went away.
+	 * @return Whether the record was sent.
+	 */
+	bool send_record(
+	    char const* header, size_t header_size, char const* message, size_t size, int flags)
+	{
+		struct iovec iov[2];
+		iov[0].iov_base = const_cast<char*>(header);
+		iov[0].iov_len = header_size;
+		iov[1].iov_base = const_cast<char*>(message);
+		iov[1].iov_len = size;
+
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = 2;
+
+		int fd = m_fd.load(std::memory_order_acquire);
+		if (fd < 0) {
+			fd = connect();
+		}
+		if (fd < 0) {
+			return false;
+		}
+		if (sendmsg(fd, &msg, flags | MSG_NOSIGNAL) >= 0) {
+			return true;
+		}
+		if (reconnect_on(errno)) {
+			fd = connect(fd);
+			return (fd >= 0) && (sendmsg(fd, &msg, flags | MSG_NOSIGNAL) >= 0);
+		}
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			// give the daemon a moment, blocks the sender thread only
+			struct pollfd pfd = {fd, POLLOUT, 0};
+			return (poll(&pfd, 1, 100) > 0) && (sendmsg(fd, &msg, flags | MSG_NOSIGNAL) >= 0);
+		}
+		return false;
+	}
+
+	/**
+	 * Sender thread: send queued records until stopped and the queue is empty.
+	 */
+	void run_async()
+	{
+		AsyncState& async = *m_async;
+		while (true) {
+			SyslogQueue::Slot const* slot = async.queue.front();
+			if (!slot) {
+				if (async.stop.load()) {
+					return;
+				}
+				std::unique_lock<std::mutex> lock(async.mutex);
+				async.sleeping.store(true);
+				// producers notify without the lock, a missed wakeup only delays
+				if (!async.queue.front() && !async.stop.load()) {
+					async.wakeup.wait_for(lock, std::chrono::milliseconds(10));
+				}
+				async.sleeping.store(false);
+				continue;
+			}
+
+			if (!send_record(slot->data, slot->size, nullptr, 0, MSG_DONTWAIT)) {
+				async.dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			async.queue.pop();
+			report_dropped();
+		}
+	}
+
+	/**
+	 * Send the records left in the queue after the sender thread stopped, requires m_async_mutex.
+	 */
+	void drain()
+	{
+		AsyncState& async = *m_async;
+		for (SyslogQueue::Slot const* slot = async.queue.front(); slot;
+		     slot = async.queue.front()) {
+			if (!send_record(slot->data, slot->size, nullptr, 0, MSG_DONTWAIT)) {
+				async.dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			async.queue.pop();
+		}
+	}
+
+	/**
+	 * Send a record about newly dropped records.
+	 */
+	void report_dropped()
+	{
+		AsyncState& async = *m_async;
+		size_t const dropped = async.dropped.load(std::memory_order_relaxed);
+		if (dropped == async.reported) {
+			return;
+		}
+		char header[header_capacity];
+		size_t const header_size = format_header(LogPriority::WARN, header, sizeof(header));
+		std::string const message = "[WARN] syslog sender dropped " +
+		                            std::to_string(dropped - async.reported) + " records";
+		if (send_record(header, header_size, message.data(), message.size(), MSG_DONTWAIT)) {
+			async.reported = dropped;
+		}
+	}
+
+	static bool reconnect_on(int error)
+	{
+		return error == ECONNREFUSED || error == ENOTCONN || error == ECONNRESET ||
+		       error == ENOENT || error == EBADF;
+	}
+
+	/**
+	 * (Re-)connect to the syslog socket. If stale_fd is given and still current, the new
+	 * connection replaces it under the same descriptor.
+	 * @return File descriptor to send to, negative if syslog is not available.
+	 */
+	int connect(int stale_fd = -1)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		int fd = m_fd.load(std::memory_order_relaxed);
+		if (fd >= 0 && fd != stale_fd) {
+			// another thread reconnected in the meantime
+			return fd;
+		}
+
+		int const new_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		if (new_fd < 0) {
+			return -1;
+		}
+		struct sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		std::strncpy(addr.sun_path, m_socket_path.c_str(), sizeof(addr.sun_path) - 1);
+		if (::connect(new_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+			::close(new_fd);
+			return -1;
+		}
+
+		if (fd < 0) {
+			m_fd.store(new_fd, std::memory_order_release);
+			return new_fd;
+		}
+		// atomically replaces the socket behind fd
+		dup3(new_fd, fd, O_CLOEXEC);
+		::close(new_fd);
+		return fd;
+	}
+
+	/**
+	 * Drop the connection to the syslog daemon, requires m_mutex. Senders may still hold the
+	 * descriptor, closing it would let an unrelated open() reuse the number and receive records.
+	 * An unconnected socket takes its place instead, the next record reconnects.
+	 */
+	void disconnect()
+	{
+		int const fd = m_fd.load(std::memory_order_relaxed);
+		if (fd < 0) {
+			return;
+		}
+		int const placeholder = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		if (placeholder >= 0) {
+			dup3(placeholder, fd, O_CLOEXEC);
+			::close(placeholder);
+		}
+	}
+
+	/**
+	 * Format RFC 5424 header "<PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD " into buffer.
+	 * Structured data exceeding the buffer is truncated.
+	 * @return Size of the header.
+	 */
+	size_t format_header(LogPriority prio, char* buffer, size_t size, Fields fields = Fields()) const
+	{
+		struct timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		// date and time change once per second only
+		thread_local time_t cached_second = -1;
+		thread_local char cached_time[32];
+		if (now.tv_sec != cached_second) {
+			struct tm tm;
+			gmtime_r(&now.tv_sec, &tm);
+			strftime(cached_time, sizeof(cached_time), "%Y-%m-%dT%H:%M:%S", &tm);
+			cached_second = now.tv_sec;
+		}
+
+		Identity const& identity = *m_identity.load(std::memory_order_acquire);
+		int const ret = snprintf(
+		    buffer, size, "<%d>1 %s.%06ldZ %s", static_cast<int>(prio) | identity.facility,
+		    cached_time, now.tv_nsec / 1000, identity.fields.c_str());
+		size_t const prefix_size = (ret < 0) ? 0 : std::min(static_cast<size_t>(ret), size - 1);
+
+		FixedOutput out(buffer + prefix_size, size - prefix_size);
+		append_structured_data(out, fields);
+		return prefix_size + out.size();
+	}
+
+	/// header buffer size, including static and per-event structured data
+	static constexpr size_t header_capacity = 2048;
+
+	/// guards (re-)connecting and the socket path
+	std::mutex m_mutex;
+	std::atomic<int> m_fd;
+	std::atomic<Identity const*> m_identity;
+	std::string m_socket_path;
+
+	/// guards starting and stopping the sender thread
+	std::mutex m_async_mutex;
+	std::atomic<bool> m_async_enabled;
+	AsyncState* m_async;
+};
+
 } // namespace detail
 
 /**
  * Macro for syslogging a message.
  *
  * Requires opening syslog beforehand and closing afterwards.
+ * Messages above the compile-time threshold are compiled out, messages above the runtime threshold
+ * (see syslog_set_threshold()) cost one relaxed atomic load.
+ * If LOGGER_SYSLOG_NATIVE is defined before including this header, messages are formatted into a
+ * per-thread buffer and sent by the native RFC 5424 client over a persistent connection instead of
+ * libc's syslog().
  * @param PRIO Log priority.
  * @param message Log message, which is streamed into a sstream.
  */
+#ifdef LOGGER_SYSLOG_NATIVE
 #define LOGGER_SYSLOG(PRIO, message)                                                               \
 	do {                                                                                           \
 		if constexpr (                                                                             \
 		    logger::LogPriority::PRIO <= logger::prio_syslog_threshold &&                          \
 		    logger::LogPriority::PRIO != logger::LogPriority::NONE) {                              \
+			if (!logger::detail::syslog_enabled(logger::LogPriority::PRIO)) {                      \
+				break;                                                                             \
+			}                                                                                      \
+			logger::detail::SyslogStream& stream = logger::detail::SyslogStream::local();          \
+			stream.begin(logger::LogPriority::PRIO) << message;                                    \
+			logger::detail::SyslogClient::instance().send(logger::LogPriority::PRIO, stream);      \
+		}                                                                                          \
+	} while (0)
+#else
+#define LOGGER_SYSLOG(PRIO, message)                                                               \
+	do {                                                                                           \
+		if constexpr (                                                                             \
+		    logger::LogPriority::PRIO <= logger::prio_syslog_threshold &&                          \
+		    logger::LogPriority::PRIO != logger::LogPriority::NONE) {                              \
+			if (!logger::detail::syslog_enabled(logger::LogPriority::PRIO)) {                      \
+				break;                                                                             \
+			}                                                                                      \
 			std::stringstream msg;                                                                 \
 			msg << message;                                                                        \
                                                                                                    \
@@ -71,6 +787,55 @@ constexpr char const* prio_to_string(LogPriority prio)
 			    logger::detail::prio_to_string(logger::LogPriority::PRIO), msg_string.c_str());    \
 		}                                                                                          \
 	} while (0)
+#endif
+
+/**
+ * Macro for syslogging a message with structured fields.
+ *
+ * Fields are sent as RFC 5424 structured data together with the static fields, cf. fields.h. With
+ * libc's syslog(), which does not support structured data, the element is prepended to the
+ * message.
+ * @param PRIO Log priority.
+ * @param fields Fields of the message, e.g. logger::fields("run", 3, "chip", name).
+ * @param message Log message, which is streamed into a sstream.
+ */
+#ifdef LOGGER_SYSLOG_NATIVE
+#define LOGGER_SYSLOG_FIELDS(PRIO, fields, message)                                                \
+	do {                                                                                           \
+		if constexpr (                                                                             \
+		    logger::LogPriority::PRIO <= logger::prio_syslog_threshold &&                          \
+		    logger::LogPriority::PRIO != logger::LogPriority::NONE) {                              \
+			if (!logger::detail::syslog_enabled(logger::LogPriority::PRIO)) {                      \
+				break;                                                                             \
+			}                                                                                      \
+			logger::detail::SyslogStream& stream = logger::detail::SyslogStream::local();          \
+			stream.begin(logger::LogPriority::PRIO) << message;                                    \
+			logger::detail::SyslogClient::instance().send(                                         \
+			    logger::LogPriority::PRIO, stream, fields);                                        \
+		}                                                                                          \
+	} while (0)
+#else
+#define LOGGER_SYSLOG_FIELDS(PRIO, fields, message)                                                \
+	do {                                                                                           \
+		if constexpr (                                                                             \
+		    logger::LogPriority::PRIO <= logger::prio_syslog_threshold &&                          \
+		    logger::LogPriority::PRIO != logger::LogPriority::NONE) {                              \
+			if (!logger::detail::syslog_enabled(logger::LogPriority::PRIO)) {                      \
+				break;                                                                             \
+			}                                                                                      \
+			std::stringstream msg;                                                                 \
+			msg << message;                                                                        \
+                                                                                                   \
+			std::string msg_string = msg.str();                                                    \
+			std::string sd_string;                                                                 \
+			logger::detail::append_structured_data(sd_string, fields);                             \
+			syslog(                                                                                \
+			    static_cast<int>(logger::LogPriority::PRIO), "[%s] %s%s",                          \
+			    logger::detail::prio_to_string(logger::LogPriority::PRIO), sd_string.c_str(),      \
+			    msg_string.c_str());                                                               \
+		}                                                                                          \
+	} while (0)
+#endif
 
 /**
  * Open syslog.
@@ -79,12 +844,33 @@ constexpr char const* prio_to_string(LogPriority prio)
  * logger is used.
  * @param option Syslog option given as bitmask flags. Can be combined via | operator.
  * @param facility Syslog facility.
+ * @param socket_path Syslog socket, only used by the native client (see LOGGER_SYSLOG_NATIVE),
+ * nullptr keeps the current one ("/dev/log" by default).
+ * @param runtime_threshold Runtime threshold set by the first call unless set before by
+ * syslog_set_threshold(), by default SYSLOG_RUNTIME_THRESHOLD of the calling translation unit.
+ *
+ * If set, the environment variable LOGGER_SYSLOG_THRESHOLD (e.g. "DEBUG") replaces
+ * runtime_threshold, it is read by the same first call only.
  */
 inline void syslog_open(
-    const char* ident = "default", int option = LOG_CONS, int facility = LOG_USER)
+    const char* ident = "default",
+    int option = LOG_CONS,
+    int facility = LOG_USER,
+    const char* socket_path = nullptr,
+    LogPriority runtime_threshold = prio_syslog_runtime_threshold)
 {
 	if constexpr (prio_syslog_threshold != logger::LogPriority::NONE) {
+		if (!detail::syslog_threshold_configured.exchange(true)) {
+			char const* threshold = std::getenv("LOGGER_SYSLOG_THRESHOLD");
+			LogPriority prio;
+			if (threshold && detail::prio_from_string(threshold, prio)) {
+				runtime_threshold = prio;
+			}
+			detail::syslog_runtime_threshold.store(static_cast<int>(runtime_threshold));
+			detail::syslog_saved_threshold.store(static_cast<int>(runtime_threshold));
+		}
 		openlog(ident, option, facility);
+		detail::SyslogClient::instance().open(ident, option, facility, socket_path);
 	}
 }
 
@@ -95,24 +881,118 @@ inline void syslog_close()
 {
 	if constexpr (prio_syslog_threshold != logger::LogPriority::NONE) {
 		closelog();
+		detail::SyslogClient::instance().close();
+	}
+}
+
+/**
+ * Set the runtime threshold. Messages above the compile-time threshold stay disabled.
+ */
+inline void syslog_set_threshold(LogPriority prio)
+{
+	detail::syslog_threshold_configured.store(true, std::memory_order_relaxed);
+	detail::syslog_runtime_threshold.store(static_cast<int>(prio), std::memory_order_relaxed);
+}
+
+/**
+ * Current runtime threshold.
+ */
+inline LogPriority syslog_threshold()
+{
+	return static_cast<LogPriority>(
+	    detail::syslog_runtime_threshold.load(std::memory_order_relaxed));
+}
+
+/**
+ * Install a signal handler toggling the runtime threshold between the compile-time threshold,
+ * i.e. everything compiled in is logged, and its previous value, e.g. `kill -USR2 <pid>`.
+ * @param signum Signal to handle.
+ */
+inline void syslog_threshold_signal(int signum = SIGUSR2)
+{
+	struct sigaction action;
+	std::memset(&action, 0, sizeof(action));
+	action.sa_handler = [](int) {
+		// lock-free atomics only, async-signal-safe
+		int const verbose = static_cast<int>(prio_syslog_threshold);
+		int const current = detail::syslog_runtime_threshold.load();
+		if (current == verbose) {
+			detail::syslog_runtime_threshold.store(detail::syslog_saved_threshold.load());
+		} else {
+			detail::syslog_saved_threshold.store(current);
+			detail::syslog_runtime_threshold.store(verbose);
+		}
+	};
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = SA_RESTART;
+	sigaction(signum, &action, nullptr);
+}
+
+/**
+ * Send syslog records from a dedicated thread.
+ *
+ * Applies to LOGGER_SYSLOG with LOGGER_SYSLOG_NATIVE and to visionary_logger::write_to_syslog.
+ * Logging threads then only copy the record into a bounded lock-free queue and never block on the
+ * syslog daemon; records not fitting into the queue are dropped and reported, see
+ * syslog_dropped().
+ * @param capacity Number of queued records.
+ */
+inline void syslog_start_async(size_t capacity = 1024)
+{
+	if constexpr (prio_syslog_threshold != logger::LogPriority::NONE) {
+		detail::SyslogClient::instance().start_async(capacity);
 	}
 }
 
+/**
+ * Send all queued records and return to sending from the logging threads.
+ */
+inline void syslog_stop_async()
+{
+	if constexpr (prio_syslog_threshold != logger::LogPriority::NONE) {
+		detail::SyslogClient::instance().stop_async();
+	}
+}
+
+/**
+ * Whether records are currently sent from the dedicated thread.
+ */
+inline bool syslog_async_enabled()
+{
+	return detail::SyslogClient::instance().async_enabled();
+}
+
+/**
+ * Number of records dropped by the asynchronous sender so far.
+ */
+inline size_t syslog_dropped()
+{
+	return detail::SyslogClient::instance().dropped();
+}
+
 /**
  * Macro suitable for one time use of logging.
  *
  * Open syslog, log the given message and close syslog again.
  * This macro is not suitable for low loglevels since opening and closing syslog multiple times adds
- * unecessary overhead.
+ * unecessary overhead. With LOGGER_SYSLOG_NATIVE, the persistent connection is kept open instead.
  * @param prio Log priority
  * @param ident Identifier for the service.
  * @param message Log message.
  */
+#ifdef LOGGER_SYSLOG_NATIVE
+#define LOGGER_OPEN_SYSLOG_CLOSE(prio, ident, ...)                                                 \
+	do {                                                                                           \
+		logger::syslog_open(ident);                                                                \
+		LOGGER_SYSLOG(prio, __VA_ARGS__);                                                          \
+	} while (0);
+#else
 #define LOGGER_OPEN_SYSLOG_CLOSE(prio, ident, ...)                                                 \
 	do {                                                                                           \
 		logger::syslog_open(ident);                                                                \
 		LOGGER_SYSLOG(prio, __VA_ARGS__);                                                          \
 		logger::syslog_close();                                                                    \
 	} while (0);
+#endif
 
 } // namespace logger
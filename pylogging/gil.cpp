@@ -0,0 +1,44 @@
+#include "gil.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace pylogging {
+
+namespace {
+
+std::atomic<bool> g_python_alive{false};
+InFlightCounter g_entries;
+
+/// upper bound for waiting on threads inside Python, they may be stuck
+constexpr std::chrono::seconds drain_timeout{5};
+
+} // anonymous namespace
+
+PythonEntry::PythonEntry()
+{
+	// Count before checking, so that shutdown() sees every admitted entry.
+	g_entries.enter();
+	m_admitted = g_python_alive.load() && Py_IsInitialized();
+}
+
+PythonEntry::~PythonEntry()
+{
+	g_entries.leave();
+}
+
+void PythonEntry::startup()
+{
+	g_python_alive.store(true);
+}
+
+void PythonEntry::shutdown()
+{
+	g_python_alive.store(false);
+
+	// the threads inside may be waiting for the GIL
+	ScopedGILRelease nogil;
+	g_entries.wait_idle(drain_timeout);
+}
+
+} // namespace pylogging
@@ -0,0 +1,158 @@
+#pragma once
+
+/**
+ * @file gil.h
+ *
+ * RAII helpers for handling the Python global interpreter lock (GIL) in the
+ * pylogging bindings.
+ *
+ * Log messages are formatted and written by log4cxx without any Python
+ * involvement, so the GIL is released around the call into log4cxx. Appenders
+ * and writers that call back into Python (PyWriter, PythonLoggingAppender) have
+ * to re-acquire it, as they may be invoked from any thread, with or without the
+ * GIL being held.
+ */
+
+#include <Python.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace pylogging {
+
+/**
+ * Number of threads inside a section, e.g. calls into Python, and waiting for
+ * all of them to leave. Entering and leaving only touch an atomic counter
+ * unless somebody waits.
+ */
+class InFlightCounter
+{
+public:
+	InFlightCounter() : m_count(0), m_waiters(0) {}
+
+	InFlightCounter(InFlightCounter const&) = delete;
+	InFlightCounter& operator=(InFlightCounter const&) = delete;
+
+	void enter()
+	{
+		++m_count;
+	}
+
+	void leave()
+	{
+		if (--m_count == 0 && m_waiters.load() != 0) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_idle.notify_all();
+		}
+	}
+
+	/**
+	 * Wait until no thread is inside, threads may be stuck though.
+	 * @return false on timeout
+	 */
+	bool wait_idle(std::chrono::steady_clock::duration timeout)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		++m_waiters;
+		bool const idle = m_idle.wait_for(lock, timeout, [this] { return m_count.load() == 0; });
+		--m_waiters;
+		return idle;
+	}
+
+private:
+	std::atomic<int> m_count;
+	std::atomic<int> m_waiters;
+	std::mutex m_mutex;
+	std::condition_variable m_idle;
+};
+
+/**
+ * Admission of log4cxx threads into Python. Once the interpreter starts
+ * finalizing, threads trying to take the GIL are hung or terminated, so
+ * shutdown() is registered with atexit: it stops new entries and waits for
+ * the threads currently inside Python.
+ *
+ * Usage:
+ *     PythonEntry entry;
+ *     if (entry) {
+ *         ScopedGILAcquire gil;
+ *         ...
+ *     }
+ */
+class PythonEntry
+{
+public:
+	PythonEntry();
+	~PythonEntry();
+
+	PythonEntry(PythonEntry const&) = delete;
+	PythonEntry& operator=(PythonEntry const&) = delete;
+
+	/// whether the calling thread may enter Python
+	explicit operator bool() const
+	{
+		return m_admitted;
+	}
+
+	/// allows entries, called when the module is imported
+	static void startup();
+
+	/// denies new entries and waits for current ones, registered with atexit
+	static void shutdown();
+
+private:
+	bool m_admitted;
+};
+
+/**
+ * Releases the GIL for the lifetime of the object, if it is held by the
+ * calling thread. Otherwise this is a no-op.
+ */
+class ScopedGILRelease
+{
+public:
+	ScopedGILRelease() :
+	    m_state((Py_IsInitialized() && PyGILState_Check()) ? PyEval_SaveThread() : nullptr)
+	{}
+
+	~ScopedGILRelease()
+	{
+		if (m_state) {
+			PyEval_RestoreThread(m_state);
+		}
+	}
+
+	ScopedGILRelease(ScopedGILRelease const&) = delete;
+	ScopedGILRelease& operator=(ScopedGILRelease const&) = delete;
+
+private:
+	PyThreadState* m_state;
+};
+
+/**
+ * Acquires the GIL for the lifetime of the object. Works from threads not
+ * created by Python and from threads already holding the GIL.
+ *
+ * The caller has to make sure the interpreter is still alive, see
+ * PythonEntry.
+ */
+class ScopedGILAcquire
+{
+public:
+	ScopedGILAcquire() : m_state(PyGILState_Ensure()) {}
+
+	~ScopedGILAcquire()
+	{
+		PyGILState_Release(m_state);
+	}
+
+	ScopedGILAcquire(ScopedGILAcquire const&) = delete;
+	ScopedGILAcquire& operator=(ScopedGILAcquire const&) = delete;
+
+private:
+	PyGILState_STATE m_state;
+};
+
+} // namespace pylogging
@@ -0,0 +1,183 @@
+/* boost::python still uses the global bind placeholders _1, _2, ...;
+ * to be removed as soon as boost::python is fixed (it isn't as of boost 1.77).
+ */
+#ifndef BOOST_BIND_GLOBAL_PLACEHOLDERS
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#endif
+
+#include <boost/python.hpp>
+
+#include <string>
+
+#include <log4cxx/logger.h>
+
+#include "gil.h"
+#include "log4cxx_handler.h"
+#include "python_logging_appender.h"
+
+using namespace boost::python;
+
+namespace pylogging {
+
+namespace {
+
+/**
+ * Maps Python log levels to log4cxx levels, inverse of the mapping used by
+ * the PythonLoggingAppender.
+ */
+log4cxx::LevelPtr convert_level(int levelno)
+{
+	if (levelno >= 50) {
+		return log4cxx::Level::getFatal(); // CRITICAL
+	} else if (levelno >= 40) {
+		return log4cxx::Level::getError();
+	} else if (levelno >= 30) {
+		return log4cxx::Level::getWarn();
+	} else if (levelno >= 20) {
+		return log4cxx::Level::getInfo();
+	} else if (levelno >= 10) {
+		return log4cxx::Level::getDebug();
+	}
+	return log4cxx::Level::getTrace();
+}
+
+/**
+ * Appends the UTF-8 representation of a Python str without creating
+ * intermediate Python objects.
+ */
+void append_utf8(std::string& out, PyObject* text)
+{
+	Py_ssize_t size = 0;
+	char const* data = PyUnicode_AsUTF8AndSize(text, &size);
+	if (data == nullptr) {
+		throw_error_already_set();
+	}
+	out.append(data, static_cast<size_t>(size));
+}
+
+/// str attribute of record as std::string, empty if it is not a str
+std::string string_attr(PyObject* record, char const* name)
+{
+	std::string ret;
+	handle<> value(PyObject_GetAttrString(record, name));
+	if (PyUnicode_Check(value.get())) {
+		append_utf8(ret, value.get());
+	}
+	return ret;
+}
+
+void emit_record(object self, object record)
+{
+	// Record was created by the PythonLoggingAppender from a log4cxx event,
+	// routing it back would loop forever.
+	if (log4cxx::PythonLoggingAppender::forwarding()) {
+		return;
+	}
+
+	PyObject* const rec = record.ptr();
+
+	std::string const name = string_attr(rec, "name");
+	log4cxx::LoggerPtr logger = (name.empty() || name == "root")
+	                                ? log4cxx::Logger::getRootLogger()
+	                                : log4cxx::Logger::getLogger(name);
+	log4cxx::LevelPtr level = convert_level(extract<int>(record.attr("levelno")));
+	if (!logger->isEnabledFor(level)) {
+		return;
+	}
+
+	// Only records with arguments need Python's %-formatting
+	std::string message;
+	handle<> msg(PyObject_GetAttrString(rec, "msg"));
+	handle<> args(PyObject_GetAttrString(rec, "args"));
+	int const has_args = PyObject_IsTrue(args.get());
+	if (has_args < 0) {
+		throw_error_already_set();
+	}
+	if (!has_args && PyUnicode_Check(msg.get())) {
+		append_utf8(message, msg.get());
+	} else {
+		object formatted = record.attr("getMessage")();
+		append_utf8(message, formatted.ptr());
+	}
+
+	object exc_info = record.attr("exc_info");
+	if (exc_info) {
+		object formatter = self.attr("formatter");
+		if (formatter.is_none()) {
+			formatter = import("logging").attr("_defaultFormatter");
+		}
+		object text = formatter.attr("formatException")(exc_info);
+		message += '\n';
+		append_utf8(message, text.ptr());
+	}
+	object stack_info = record.attr("stack_info");
+	if (stack_info && PyUnicode_Check(stack_info.ptr())) {
+		message += '\n';
+		append_utf8(message, stack_info.ptr());
+	}
+
+	std::string const pathname = string_attr(rec, "pathname");
+	std::string const function = string_attr(rec, "funcName");
+	int const lineno = extract<int>(record.attr("lineno"));
+	log4cxx::spi::LocationInfo location(
+	    pathname.c_str(), log4cxx::spi::LocationInfo::calcShortFileName(pathname.c_str()),
+	    function.c_str(), lineno);
+
+	ScopedGILRelease nogil;
+	logger->forcedLog(level, message, location);
+}
+
+/// logging.Handler.emit(record), errors are reported via handleError
+void emit(object self, object record)
+{
+	try {
+		emit_record(self, record);
+	} catch (error_already_set const&) {
+		// handleError prints the exception being handled, i.e. sys.exc_info(), and Python must
+		// not be called with an error set: the error becomes the handled exception meanwhile
+		PyObject* type;
+		PyObject* value;
+		PyObject* traceback;
+		PyErr_Fetch(&type, &value, &traceback);
+		PyErr_NormalizeException(&type, &value, &traceback);
+		if (traceback) {
+			PyException_SetTraceback(value, traceback);
+		}
+		PyObject* handled_type;
+		PyObject* handled_value;
+		PyObject* handled_traceback;
+		PyErr_GetExcInfo(&handled_type, &handled_value, &handled_traceback);
+		PyErr_SetExcInfo(type, value, traceback);
+		try {
+			self.attr("handleError")(record);
+		} catch (error_already_set const&) {
+			PyErr_SetExcInfo(handled_type, handled_value, handled_traceback);
+			throw;
+		}
+		PyErr_SetExcInfo(handled_type, handled_value, handled_traceback);
+	}
+}
+
+} // anonymous namespace
+
+void register_log4cxx_handler()
+{
+	object handler_base = import("logging").attr("Handler");
+
+	dict members;
+	members["__module__"] = scope().attr("__name__");
+	members["__doc__"] =
+	    "logging.Handler routing records of the Python logging module into log4cxx.\n"
+	    "Records of logger 'a.b' are logged to the log4cxx logger 'a.b' (the root\n"
+	    "logger is mapped to the log4cxx root logger) and pass its level and\n"
+	    "appenders. Python levels are mapped to the closest LogLevel, source\n"
+	    "location is taken from the record's pathname, funcName and lineno.\n"
+	    "Example:\n"
+	    "    logging.getLogger().addHandler(pylogging.Log4cxxHandler())\n";
+	members["emit"] = make_function(&emit);
+
+	object type(handle<>(borrowed(reinterpret_cast<PyObject*>(&PyType_Type))));
+	scope().attr("Log4cxxHandler") = type("Log4cxxHandler", make_tuple(handler_base), members);
+}
+
+} // namespace pylogging
@@ -0,0 +1,18 @@
+#pragma once
+
+/**
+ * @file log4cxx_handler.h
+ *
+ * Python logging.Handler subclass implemented in C++ which routes records of
+ * the Python "logging" module into log4cxx, the counterpart of the
+ * PythonLoggingAppender.
+ */
+
+namespace pylogging {
+
+/**
+ * Creates the class Log4cxxHandler in the current boost::python scope.
+ */
+void register_log4cxx_handler();
+
+} // namespace pylogging
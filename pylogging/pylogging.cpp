@@ -1,5 +1,8 @@
+#include <charconv>
 #include <memory>
 #include <iostream>
+#include <string>
+#include <vector>
 
 /* boost::python still uses the global bind placeholders _1, _2, ...;
  * to be removed as soon as boost::python is fixed (it isn't as of boost 1.77).
@@ -22,9 +25,14 @@
 
 #include <log4cxx/filter/levelrangefilter.h>
 
+#include "logger/log4cxx/appender_snapshot.h"
+#include "logger/log4cxx/capture_appender.h"
 #include "logger/log4cxx/logging_ctrl.h"
 #include "logger/log4cxx/logger.h"
+#include "gil.h"
+#include "log4cxx_handler.h"
 #include "python_logging_appender.h"
+#include "pywriter.h"
 
 using namespace boost::python;
 
@@ -55,23 +63,40 @@ namespace {
 	bool lt(log4cxx::LevelPtr, log4cxx::LevelPtr) { throw std::runtime_error("No order defined on loglevels"); }
 	bool le(log4cxx::LevelPtr, log4cxx::LevelPtr) { throw std::runtime_error("No order defined on loglevels"); }
 
+	/// Location of the calling Python code, strings are owned for LocationInfo
+	struct PythonLocation
+	{
+		std::string filename;
+		std::string function;
+		int lineno;
+
+		PythonLocation()
+		{
+			object inspect = import("inspect");
+			object frameinfo = inspect.attr("getframeinfo")(inspect.attr("currentframe")());
+			filename = extract<std::string>(frameinfo.attr("filename"));
+			function = extract<std::string>(frameinfo.attr("function"));
+			lineno = extract<int>(frameinfo.attr("lineno"));
+		}
+
+		log4cxx::spi::LocationInfo info() const
+		{
+			return log4cxx::spi::LocationInfo(
+				filename.c_str(), log4cxx::spi::LocationInfo::calcShortFileName(filename.c_str()),
+				function.c_str(), lineno);
+		}
+	};
+
 	object log(log4cxx::LevelPtr level, tuple args)
 	{
 		log4cxx::LoggerPtr logger = extract<log4cxx::LoggerPtr>(args[0]);
 		// Simulate: LOG4CXX_LOG macro
 		if (logger->isEnabledFor(level))
 		{
-			object message_args = args[slice(1, slice_nil())];
 			::log4cxx::helpers::LogCharMessageBuffer oss_;
 
-			object inspect = import("inspect");
-			object frameinfo = inspect.attr("getframeinfo")(inspect.attr("currentframe")());
-			std::string filename = extract<std::string>(frameinfo.attr("filename"));
-			std::string function = extract<std::string>(frameinfo.attr("function"));
-			int lineno = extract<int>(frameinfo.attr("lineno"));
-			log4cxx::spi::LocationInfo location(
-				filename.c_str(), log4cxx::spi::LocationInfo::calcShortFileName(filename.c_str()),
-				function.c_str(), lineno);
+			PythonLocation const caller;
+			log4cxx::spi::LocationInfo location = caller.info();
 
 			stl_input_iterator<object> it(args), end;
 			++it; // Skip logger
@@ -80,11 +105,211 @@ namespace {
 				std::string value = extract<std::string>(str(*it));
 				oss_ << value;
 			}
+
+			// log4cxx formatting and appender I/O do not touch Python objects,
+			// appenders calling back into Python re-acquire the GIL themselves
+			pylogging::ScopedGILRelease nogil;
 			logger->forcedLog(level, oss_.str(oss_), location);
 		}
 		return object();
 	}
 
+	/**
+	 * One value column of log_batch(): either a one-dimensional buffer of
+	 * numbers (e.g. a NumPy array), read without the GIL, or any other
+	 * sequence, converted to strings upfront.
+	 */
+	class BatchColumn
+	{
+	public:
+		explicit BatchColumn(object const& values) : m_has_view(false), m_format(0)
+		{
+			if (PyObject_CheckBuffer(values.ptr()) &&
+			    PyObject_GetBuffer(values.ptr(), &m_view, PyBUF_RECORDS_RO) == 0) {
+				m_has_view = true;
+				m_format = numeric_format(m_view);
+				if (m_view.ndim == 1 && m_format != 0) {
+					m_size = static_cast<size_t>(m_view.shape[0]);
+					return;
+				}
+				PyBuffer_Release(&m_view);
+				m_has_view = false;
+			}
+			PyErr_Clear();
+
+			stl_input_iterator<object> it(values), end;
+			for (; it != end; ++it) {
+				m_strings.push_back(extract<std::string>(str(*it)));
+			}
+			m_size = m_strings.size();
+		}
+
+		// requires the GIL
+		~BatchColumn()
+		{
+			if (m_has_view) {
+				PyBuffer_Release(&m_view);
+			}
+		}
+
+		BatchColumn(BatchColumn const&) = delete;
+		BatchColumn& operator=(BatchColumn const&) = delete;
+
+		size_t size() const { return m_size; }
+
+		// does not require the GIL
+		void append(std::string& out, size_t i) const
+		{
+			if (!m_has_view) {
+				out += m_strings[i];
+				return;
+			}
+			char const* p = static_cast<char const*>(m_view.buf) +
+			                static_cast<Py_ssize_t>(i) * m_view.strides[0];
+			switch (m_format) {
+				case 'b': return append_number(out, *reinterpret_cast<signed char const*>(p));
+				case 'B': return append_number(out, *reinterpret_cast<unsigned char const*>(p));
+				case 'h': return append_number(out, *reinterpret_cast<short const*>(p));
+				case 'H': return append_number(out, *reinterpret_cast<unsigned short const*>(p));
+				case 'i': return append_number(out, *reinterpret_cast<int const*>(p));
+				case 'I': return append_number(out, *reinterpret_cast<unsigned int const*>(p));
+				case 'l': return append_number(out, *reinterpret_cast<long const*>(p));
+				case 'L': return append_number(out, *reinterpret_cast<unsigned long const*>(p));
+				case 'q': return append_number(out, *reinterpret_cast<long long const*>(p));
+				case 'Q': return append_number(out, *reinterpret_cast<unsigned long long const*>(p));
+				case 'f': return append_number(out, *reinterpret_cast<float const*>(p));
+				case 'd': return append_number(out, *reinterpret_cast<double const*>(p));
+				case '?': out += *reinterpret_cast<bool const*>(p) ? "True" : "False"; return;
+			}
+		}
+
+	private:
+		/// struct format character of supported native-order number buffers, else 0
+		static char numeric_format(Py_buffer const& view)
+		{
+			char const* format = view.format ? view.format : "B";
+			if (*format == '@' || *format == '=' ||
+			    (*format == '<' && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ||
+			    (*format == '>' && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)) {
+				++format;
+			}
+			if (format[0] == 0 || format[1] != 0) {
+				return 0;
+			}
+			switch (format[0]) {
+				case 'b': case 'B': case 'h': case 'H': case 'i': case 'I':
+				case 'l': case 'L': case 'q': case 'Q': case 'f': case 'd': case '?':
+					return format[0];
+			}
+			return 0;
+		}
+
+		template <typename T>
+		static void append_number(std::string& out, T value)
+		{
+			char buffer[32];
+			std::to_chars_result const res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+			out.append(buffer, res.ptr);
+		}
+
+		Py_buffer m_view;
+		bool m_has_view;
+		char m_format;
+		std::vector<std::string> m_strings;
+		size_t m_size;
+	};
+
+	/**
+	 * Logs many records for one logger and level at the cost of roughly one
+	 * call: enablement and caller location are evaluated once, records are
+	 * formatted and handed to log4cxx with the GIL released.
+	 *
+	 * log_batch(logger, level, messages)
+	 *     logs str(m) for every m in messages
+	 * log_batch(logger, level, format, values0, values1, ...)
+	 *     logs format with its {} placeholders replaced by the i-th element of
+	 *     each values sequence, for every i; values are typically NumPy arrays
+	 */
+	object log_batch(tuple args, dict)
+	{
+		if (len(args) < 3) {
+			PyErr_SetString(PyExc_TypeError, "log_batch(logger, level, messages | format, *values)");
+			throw_error_already_set();
+		}
+		log4cxx::LoggerPtr logger = extract<log4cxx::LoggerPtr>(args[0]);
+		log4cxx::LevelPtr level = extract<log4cxx::LevelPtr>(args[1]);
+		if (!logger->isEnabledFor(level)) {
+			return object();
+		}
+
+		PythonLocation const caller;
+		log4cxx::spi::LocationInfo location = caller.info();
+
+		if (len(args) == 3) {
+			if (PyUnicode_Check(object(args[2]).ptr())) {
+				PyErr_SetString(PyExc_TypeError, "messages has to be a sequence of messages");
+				throw_error_already_set();
+			}
+			std::vector<std::string> messages;
+			stl_input_iterator<object> it(args[2]), end;
+			for (; it != end; ++it) {
+				messages.push_back(extract<std::string>(str(*it)));
+			}
+
+			pylogging::ScopedGILRelease nogil;
+			for (std::string const& message : messages) {
+				logger->forcedLog(level, message, location);
+			}
+			return object();
+		}
+
+		// split format into the literal parts around the {} placeholders
+		std::string const format = extract<std::string>(args[2]);
+		std::vector<std::string> literals(1);
+		for (size_t i = 0; i < format.size(); ++i) {
+			if ((format[i] == '{' || format[i] == '}') && i + 1 < format.size() &&
+			    format[i + 1] == format[i]) {
+				literals.back() += format[i++];
+			} else if (format.compare(i, 2, "{}") == 0) {
+				literals.emplace_back();
+				++i;
+			} else {
+				literals.back() += format[i];
+			}
+		}
+
+		std::vector<std::unique_ptr<BatchColumn> > columns;
+		for (ssize_t i = 3; i < len(args); ++i) {
+			columns.emplace_back(new BatchColumn(object(args[i])));
+		}
+		if (columns.size() != literals.size() - 1) {
+			PyErr_SetString(PyExc_ValueError, "number of {} placeholders and value sequences differ");
+			throw_error_already_set();
+		}
+		size_t const size = columns.front()->size();
+		for (auto const& column : columns) {
+			if (column->size() != size) {
+				PyErr_SetString(PyExc_ValueError, "value sequences differ in length");
+				throw_error_already_set();
+			}
+		}
+
+		{
+			pylogging::ScopedGILRelease nogil;
+			std::string message;
+			for (size_t i = 0; i < size; ++i) {
+				message.clear();
+				for (size_t c = 0; c < columns.size(); ++c) {
+					message += literals[c];
+					columns[c]->append(message, i);
+				}
+				message += literals.back();
+				logger->forcedLog(level, message, location);
+			}
+		}
+		return object();
+	}
+
 	object LOG_FATAL (tuple args, dict) { return log(log4cxx::Level::getFatal(), args); }
 	object LOG_ERROR (tuple args, dict) { return log(log4cxx::Level::getError(), args); }
 	object LOG_WARN  (tuple args, dict) { return log(log4cxx::Level::getWarn(),  args); }
@@ -99,7 +324,50 @@ namespace {
 	}
 
 	size_t get_number_of_appenders(log4cxx::LoggerPtr logger) {
-		return logger->getAllAppenders().size();
+		return visionary_logger::appender_chain(logger)->own;
+	}
+
+	void set_additivity(log4cxx::LoggerPtr logger, bool additive)
+	{
+		logger->setAdditivity(additive);
+		// not reported by log4cxx
+		visionary_logger::appenders_changed();
+	}
+
+	// Functions closing or replacing appenders must not hold the GIL: another
+	// thread might be stuck inside an appender waiting for it.
+	void reset()
+	{
+		pylogging::ScopedGILRelease nogil;
+		logger_reset();
+	}
+
+	void default_config(
+	    log4cxx::LevelPtr level,
+	    std::string fname,
+	    bool dual,
+	    bool print_location,
+	    bool use_color,
+	    std::string date_format,
+	    bool json,
+	    bool watch,
+	    bool fanout)
+	{
+		pylogging::ScopedGILRelease nogil;
+		logger_default_config(
+		    level, fname, dual, print_location, use_color, date_format, json, watch, fanout);
+	}
+
+	void config_from_file(std::string filename)
+	{
+		pylogging::ScopedGILRelease nogil;
+		logger_config_from_file(filename);
+	}
+
+	log4cxx::AppenderPtr watch_config(std::string filename)
+	{
+		pylogging::ScopedGILRelease nogil;
+		return logger_watch_config(filename);
 	}
 
 
@@ -116,7 +384,9 @@ namespace {
 		// Check whether a logger for this domain was already added -- if yes,
 		// do nothing. It makes no sense to log to the same logging domain
 		// multiple times
-		for (log4cxx::AppenderPtr& ptr : logger->getAllAppenders()) {
+		visionary_logger::AppenderChainPtr const chain = visionary_logger::appender_chain(logger);
+		for (size_t i = 0; i < chain->own; ++i) {
+			log4cxx::AppenderPtr const& ptr = chain->appenders[i];
 			log4cxx::PythonLoggingAppender* pyapp =
 			    dynamic_cast<log4cxx::PythonLoggingAppender*>(&*ptr);
 			if (pyapp && pyapp->domain() == domain) {
@@ -128,25 +398,137 @@ namespace {
 		logger->addAppender(appender);
 		return appender;
 	}
-} // anonymous namespace
 
-class PyWriter : public log4cxx::helpers::Writer
-{
-	void close(log4cxx::helpers::Pool &) {}
-	void flush(log4cxx::helpers::Pool &) {}
-	void write(const log4cxx::LogString &str, log4cxx::helpers::Pool &)
+	void console_set_writer(log4cxx::ConsoleAppender& appender, log4cxx::helpers::WriterPtr writer)
 	{
-		PySys_WriteStdout(str.c_str());
+		appender.setWriter(writer);
+		// lets buffered PyWriters write out e.g. errors right away
+		if (std::dynamic_pointer_cast<PyWriter>(writer)) {
+			PyWriterLevelFilter::attach(appender);
+		}
+	}
+
+	/**
+	 * Context manager attaching a CaptureAppender to a logger while active, see capture().
+	 * Captured events stay available after leaving the context.
+	 */
+	class Capture
+	{
+	public:
+		Capture(log4cxx::LoggerPtr logger, size_t capacity, log4cxx::LevelPtr level) :
+		    m_logger(logger), m_appender(new log4cxx::CaptureAppender(capacity, level))
+		{}
+
+		log4cxx::CaptureAppenderPtr appender() const
+		{
+			return m_appender;
+		}
+
+		void attach()
+		{
+			m_logger->addAppender(m_appender);
+		}
+
+		void detach()
+		{
+			m_logger->removeAppender(m_appender);
+			visionary_logger::appenders_changed();
+		}
+
+	private:
+		log4cxx::LoggerPtr m_logger;
+		log4cxx::CaptureAppenderPtr m_appender;
+	};
+
+	object capture_enter(object self)
+	{
+		Capture& capture = extract<Capture&>(self);
+		capture.attach();
+		return self;
+	}
+
+	bool capture_exit(Capture& self, object, object, object)
+	{
+		self.detach();
+		return false;
+	}
+
+	Capture* make_capture(log4cxx::LoggerPtr logger, size_t capacity, log4cxx::LevelPtr level)
+	{
+		return new Capture(logger, capacity, level);
+	}
+
+	list capture_events(Capture const& self)
+	{
+		list ret;
+		for (log4cxx::CapturedEvent const& event : self.appender()->events()) {
+			ret.append(event);
+		}
+		return ret;
 	}
-};
 
-LOG4CXX_PTR_DEF(PyWriter);
+	/// captured text may still be invalid UTF-8, e.g. binary data logged from C++
+	object decode_captured(std::string const& str)
+	{
+		return object(handle<>(
+		    PyUnicode_DecodeUTF8(str.data(), static_cast<Py_ssize_t>(str.size()), "replace")));
+	}
+
+	list capture_messages(Capture const& self)
+	{
+		list ret;
+		for (std::string const& message : self.appender()->messages()) {
+			ret.append(decode_captured(message));
+		}
+		return ret;
+	}
+
+	void capture_clear(Capture const& self)
+	{
+		self.appender()->clear();
+	}
+
+	size_t capture_len(Capture const& self)
+	{
+		return self.appender()->size();
+	}
+
+	log4cxx::AppenderPtr capture_appender(Capture const& self)
+	{
+		return self.appender();
+	}
+
+	int64_t event_timestamp(log4cxx::CapturedEvent const& event)
+	{
+		return event.timestamp;
+	}
+
+	log4cxx::LevelPtr event_level(log4cxx::CapturedEvent const& event)
+	{
+		return event.level;
+	}
+
+	object event_logger(log4cxx::CapturedEvent const& event)
+	{
+		return decode_captured(event.logger);
+	}
+
+	object event_message(log4cxx::CapturedEvent const& event)
+	{
+		return decode_captured(event.message);
+	}
+} // anonymous namespace
+
 
 typedef return_value_policy<copy_const_reference> ccr;
 typedef return_value_policy<reference_existing_object> reo;
 
 BOOST_PYTHON_MODULE(pylogging)
 {
+	// runs after the atexit hooks registered below, e.g. PyWriter::flush_all
+	pylogging::PythonEntry::startup();
+	import("atexit").attr("register")(make_function(&pylogging::PythonEntry::shutdown));
+
 	class_<log4cxx::helpers::Pool, boost::noncopyable>(
 			"Pool")
 	;
@@ -156,11 +538,30 @@ BOOST_PYTHON_MODULE(pylogging)
 			"Writer class that writes to python stdout.\n"
 			"Example:\n"
 			"    appender = pylogging.log_to_cout(pylogging.LogLevel.WARN)\n"
-			"    appender.setWriter(pylogging.PyWriter())\n",
-			init<>())
+			"    appender.setWriter(pylogging.PyWriter())\n"
+			"\n"
+			"In buffered mode lines are collected and written in chunks, once\n"
+			"flush_size bytes are pending or the oldest pending line is older\n"
+			"than flush_interval seconds, and at interpreter shutdown. Lines of\n"
+			"events at or above the flush level (ERROR) are written out right\n"
+			"away, together with all pending lines:\n"
+			"    writer = pylogging.PyWriter(buffered=True)\n"
+			"    writer.setFlushLevel(pylogging.LogLevel.WARN)\n"
+			"    appender.setWriter(writer)\n",
+			init<optional<bool, size_t, double> >(
+				(arg("buffered") = false, arg("flush_size") = 64 * 1024,
+				 arg("flush_interval") = 0.5)))
+		.def("flush", &PyWriter::flush_buffer, "Write out all pending lines")
+		.def("setFlushLevel", &PyWriter::setFlushLevel,
+			"Lines of events at or above level are written out right away")
+		.def("getFlushLevel", &PyWriter::getFlushLevel)
+		.add_property("buffered", &PyWriter::buffered)
 	;
 	implicitly_convertible<PyWriterPtr, log4cxx::helpers::WriterPtr>();
 
+	// write out buffered PyWriters before the interpreter goes away
+	import("atexit").attr("register")(make_function(&PyWriter::flush_all));
+
 	class_<log4cxx::spi::OptionHandler, log4cxx::spi::OptionHandlerPtr, boost::noncopyable>(
 			"OptionHandler", no_init)
 		.def("activateOptions", &log4cxx::spi::OptionHandler::activateOptions)
@@ -204,9 +605,12 @@ BOOST_PYTHON_MODULE(pylogging)
 		.def("warn",  raw_function(LOG_WARN , 1))
 		.def("error", raw_function(LOG_ERROR, 1))
 		.def("fatal", raw_function(LOG_FATAL, 1))
+		.def("log_batch", raw_function(log_batch, 3),
+			 "log_batch(level, messages) or log_batch(level, format, *values)\n"
+			 "Logs many records at once, see pylogging.log_batch.")
 		.def("addAppender", &log4cxx::Logger::addAppender, "Add newAppender to the list of appenders of this Logger instance.\n"
 				                                           "If newAppender is already in the list of appenders, then it won't be added again.")
-		.def("setAdditivity", &log4cxx::Logger::setAdditivity, "Set the additivity flag for this Logger instance.")
+		.def("setAdditivity", set_additivity, "Set the additivity flag for this Logger instance.")
 		.def("getName", static_cast<log4cxx::LogString const& (log4cxx::Logger::*)() const>(&log4cxx::Logger::getName), ccr(),
 			 "Get the logger name.")
 		.def("get_number_of_appenders", get_number_of_appenders, "for debug/test use")
@@ -236,7 +640,7 @@ BOOST_PYTHON_MODULE(pylogging)
 				"Sets the value of the target property. Recognized values "
 				"are \"System.out\" and \"System.err\". Any other value will be "
 				"ignored.")
-		.def("setWriter", &log4cxx::ConsoleAppender::setWriter)
+		.def("setWriter", console_set_writer)
 		.def("getSystemOut", &log4cxx::ConsoleAppender::getSystemOut, ccr()).staticmethod("getSystemOut")
 		.def("getSystemErr", &log4cxx::ConsoleAppender::getSystemErr, ccr()).staticmethod("getSystemErr")
 	;
@@ -273,15 +677,38 @@ BOOST_PYTHON_MODULE(pylogging)
 	;
 	implicitly_convertible< log4cxx::filter::LevelRangeFilterPtr, log4cxx::spi::FilterPtr>();
 
-	def("reset", logger_reset, "Reset the logger config");
+	class_<log4cxx::CapturedEvent>("CapturedEvent", "Log event captured by capture()", no_init)
+		.add_property("timestamp", event_timestamp, "microseconds since epoch")
+		.add_property("level", event_level)
+		.add_property("logger", event_logger)
+		.add_property("message", event_message)
+	;
+
+	class_<Capture, boost::noncopyable>(
+			"Capture",
+			"Events captured in memory, see capture()",
+			init<log4cxx::LoggerPtr, size_t, log4cxx::LevelPtr>())
+		.def("__enter__", capture_enter)
+		.def("__exit__", capture_exit)
+		.def("__len__", capture_len)
+		.def("events", capture_events, "Captured events, oldest first")
+		.def("messages", capture_messages, "Messages of the captured events, oldest first")
+		.def("clear", capture_clear, "Forget all captured events")
+		.add_property("appender", capture_appender, "The underlying appender")
+	;
+
+	def("reset", reset, "Reset the logger config");
 
-	def("default_config", logger_default_config,
+	def("default_config", default_config,
 			( arg("level") = log4cxx::Level::getWarn(),
 			  arg("fname")="",
 			  arg("dual")=false,
 			  arg("print_location")=false,
 			  arg("color")=true,
-			  arg("date_format")="ABSOLUTE"),
+			  arg("date_format")="ABSOLUTE",
+			  arg("json")=false,
+			  arg("watch")=false,
+			  arg("fanout")=false),
 		"This is the default configuration procedure for the logger\n"
 		"If the file 'symap2ic_logger.conf' is found, it is used to configure the\n"
 		"logger and every other argument is ignored!\n"
@@ -290,18 +717,37 @@ BOOST_PYTHON_MODULE(pylogging)
 		"@arg dual: If file is given, log also to stdout\n"
 		"@print_location: Include location of error into log message\n"
 		"@use_color: Print colorfull\n"
-		"@arg date_format: values are: NULL, RELATIVE, ABSOLUTE, DATE, ISO8601\n");
+		"@arg date_format: values are: NULL, RELATIVE, ABSOLUTE, DATE, ISO8601\n"
+		"@arg json: Write JSON lines to the file\n"
+		"@arg watch: Reload 'symap2ic_logger.conf' whenever it changes\n"
+		"@arg fanout: Unless json is set or date_format is RELATIVE/NULL, the root logger\n"
+		"gets a single appender 'FANOUT' for console and file instead of 'COUT' and 'FILE'.\n");
 
-	def("config_from_file", logger_config_from_file,
+	def("config_from_file", config_from_file,
 			"Load logger config from the given configuration file");
 
+	def("compile_config", logger_compile_config, (arg("filename"), arg("output")),
+	    "Write the given configuration file in the binary form loaded without parsing");
+
+	def("watch_config", watch_config, (arg("filename") = "symap2ic_logger.conf"),
+	    "Load logger config from the given configuration file and reload it whenever it changes");
+
 	def("append_to_file", logger_append_to_file,
 	    (arg("filename"), arg("logger") = log4cxx::Logger::getRootLogger()),
 	    "adds a FileAppender to the given logger");
 
 	def("write_to_file", logger_write_to_file,
-	    (arg("filename"), arg("append") = false, arg("logger") = log4cxx::Logger::getRootLogger()),
-	    "adds a FileAppender to the given logger");
+	    (arg("filename"), arg("append") = false, arg("logger") = log4cxx::Logger::getRootLogger(),
+	     arg("json") = false),
+	    "adds a FileAppender to the given logger, writing JSON lines if json is set");
+
+	def("write_to_file_async", logger_write_to_file_async,
+	    (arg("filename"), arg("append") = false, arg("logger") = log4cxx::Logger::getRootLogger(),
+	     arg("json") = false),
+	    "adds an AsyncFileAppender to the given logger, writing from a background thread");
+
+	def("console_colors", logger_console_colors,
+	    "whether console output is colored, i.e. stdout is a terminal");
 
 	def("write_to_cout", logger_write_to_cout, (arg("logger") = log4cxx::Logger::getRootLogger()),
 	    "adds a ConsoleAppender to the given logger");
@@ -315,6 +761,24 @@ BOOST_PYTHON_MODULE(pylogging)
 	def("append_to_logging", logger_write_to_logging, (arg("domain"), arg("logger") = log4cxx::Logger::getRootLogger()),
 	    "adds a PythonLoggingAppender to the given logger");
 
+	pylogging::register_log4cxx_handler();
+
+	def("capture", make_capture, return_value_policy<manage_new_object>(),
+	    (arg("logger") = log4cxx::Logger::getRootLogger(), arg("capacity") = 1024,
+	     arg("level") = log4cxx::Level::getAll()),
+	    "Context manager capturing the most recent events of logger in memory.\n"
+	    "At most capacity events at or above level are kept, messages are\n"
+	    "truncated to 1024 bytes. The logger's own level still applies.\n"
+	    "Example:\n"
+	    "    with pylogging.capture(pylogging.get(\"test\")) as captured:\n"
+	    "        ...\n"
+	    "    assert \"expected\" in captured.messages()[-1]\n");
+
+	def("set_logging_fallback", &log4cxx::PythonLoggingAppender::set_fallback_file,
+	    (arg("filename") = ""),
+	    "Sets the file events for Python logging are written to once the\n"
+	    "interpreter is shutting down, stderr if empty");
+
 	def("log_to_file", logger_log_to_file,
 			"Configure the logger to log everything above the given loglevel to a file");
 
@@ -330,6 +794,17 @@ BOOST_PYTHON_MODULE(pylogging)
 			(arg("level") = Logger::log4cxx_level(LOGGER_DEFAULT_LEVEL), arg("file") = "", arg("dual") = false),
 			"Returns the old style default logger, usage is deprecated");
 
+    def("log_batch", raw_function(log_batch, 3));
+    scope().attr("log_batch").attr("__doc__") =
+        "log_batch(logger, level, messages) or log_batch(logger, level, format, *values)\n"
+        "Logs many records for one logger and level in a single call: enablement\n"
+        "and caller location are evaluated once, the records are formatted and\n"
+        "written with the GIL released.\n"
+        "@arg messages: sequence, str() of every element is logged\n"
+        "@arg format: message with one {} placeholder per values argument\n"
+        "@arg values: equally long sequences, e.g. one-dimensional NumPy arrays\n"
+        "             of numbers, which are read without creating Python objects\n";
+
     def("LOG4CXX_TRACE", raw_function(LOG_TRACE, 1));
     def("LOG4CXX_DEBUG", raw_function(LOG_DEBUG, 1));
     def("LOG4CXX_INFO",  raw_function(LOG_INFO , 1));
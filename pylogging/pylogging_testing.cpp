@@ -0,0 +1,87 @@
+/**
+ * @file
+ * Test-only extension for the pylogging tests: native threads logging while
+ * the interpreter resets or finalizes. Not installed.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#ifndef BOOST_BIND_GLOBAL_PLACEHOLDERS
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#endif
+
+#include <boost/python.hpp>
+
+#include <log4cxx/logger.h>
+
+#include "logger/log4cxx/logger.h"
+
+#include "gil.h"
+
+namespace {
+
+/// native threads started by log_from_native_threads
+struct NativeLoggingThreads
+{
+	std::atomic<bool> stop{false};
+	std::vector<std::thread> threads;
+
+	static NativeLoggingThreads& instance()
+	{
+		// leaked on purpose, joined by atexit
+		static NativeLoggingThreads* threads = new NativeLoggingThreads;
+		return *threads;
+	}
+
+	static void join_all()
+	{
+		// the threads may be waiting for the GIL
+		pylogging::ScopedGILRelease nogil;
+		NativeLoggingThreads& self = instance();
+		self.stop.store(true);
+		for (std::thread& thread : self.threads) {
+			thread.join();
+		}
+		self.threads.clear();
+		self.stop.store(false);
+	}
+};
+
+/**
+ * Starts threads not known to Python that log to logger until
+ * join_native_threads() is called or the process exits, i.e. also while
+ * the interpreter is finalized. They are joined by a C atexit handler,
+ * before log4cxx itself is destroyed.
+ */
+void log_from_native_threads(log4cxx::LoggerPtr logger, size_t n_threads)
+{
+	static bool const registered = (std::atexit(&NativeLoggingThreads::join_all) == 0);
+	static_cast<void>(registered);
+
+	NativeLoggingThreads& threads = NativeLoggingThreads::instance();
+	for (size_t t = 0; t < n_threads; ++t) {
+		threads.threads.emplace_back([logger, &threads, t] {
+			for (size_t i = 0; !threads.stop.load(std::memory_order_relaxed); ++i) {
+				LOG4CXX_INFO(logger, "native thread " << t << " message " << i);
+			}
+		});
+	}
+}
+
+
+} // anonymous namespace
+
+BOOST_PYTHON_MODULE(_pylogging_testing)
+{
+	using namespace boost::python;
+
+	// for log4cxx::LoggerPtr
+	import("pylogging");
+
+	def("log_from_native_threads", &log_from_native_threads,
+	    (arg("logger"), arg("n_threads")));
+	def("join_native_threads", &NativeLoggingThreads::join_all);
+}
@@ -15,7 +15,16 @@
  *  You should have received a copy of the GNU General Public License
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+extern "C" {
+#include <fcntl.h>
+#include <unistd.h>
+}
 
 /* boost::python still uses the global bind placeholders _1, _2, ...;
  * to be removed as soon as boost::python is fixed (it isn't as of boost 1.77).
@@ -26,33 +35,132 @@
 
 #include <boost/python.hpp>
 
+#include <log4cxx/spi/loggingevent.h>
+
+#include "gil.h"
 #include "python_logging_appender.h"
 
 namespace log4cxx {
 
+namespace {
+
+/// set while the thread forwards an event to Python
+thread_local bool t_forwarding = false;
+
+struct ForwardingGuard
+{
+	ForwardingGuard() : m_previous(t_forwarding) { t_forwarding = true; }
+	~ForwardingGuard() { t_forwarding = m_previous; }
+
+private:
+	bool const m_previous;
+};
+
+/// upper bound for waiting on in-flight events, their threads may be stuck
+constexpr std::chrono::seconds drain_timeout{5};
+
+/**
+ * Native sink for events that arrive after the interpreter is gone, stderr
+ * unless a file is configured.
+ */
+struct FallbackSink
+{
+	std::mutex mutex;
+	int fd = STDERR_FILENO;
+
+	void set_file(std::string const& filename)
+	{
+		int new_fd = STDERR_FILENO;
+		if (!filename.empty()) {
+			new_fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+			if (new_fd < 0) {
+				throw std::runtime_error("could not open fallback log file '" + filename + "'");
+			}
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		if (fd != STDERR_FILENO) {
+			::close(fd);
+		}
+		fd = new_fd;
+	}
+
+	void write(const spi::LoggingEventPtr& event)
+	{
+		std::string line;
+		event->getLevel()->toString(line);
+		line += ' ';
+		line += event->getLoggerName();
+		line += ' ';
+		line += event->getMessage();
+		line += '\n';
+
+		// single write per line, lines of concurrent threads don't interleave
+		std::lock_guard<std::mutex> lock(mutex);
+		ssize_t ret = ::write(fd, line.data(), line.size());
+		static_cast<void>(ret);
+	}
+};
+
+FallbackSink& fallback_sink()
+{
+	// leaked on purpose, used until the very end of the process
+	static FallbackSink* instance = new FallbackSink;
+	return *instance;
+}
+
+} // anonymous namespace
+
 /**
  * Actual implementation of the PythonLoggingAppender. This class is responsible
  * for actually sending the log messages to the Python "logging" module. This
  * module is lazily loaded once the first log message is received.
+ *
+ * Lifecycle: the appender is ACTIVE until close() moves it to CLOSING, waits
+ * for events in flight on other threads and drops the Python logger, ending
+ * in CLOSED. Events arriving when closed are dropped; events arriving after
+ * the interpreter shut down go to the fallback sink.
  */
 class PythonLoggingAppenderImpl
 {
 private:
-	std::string m_domain;
-	boost::python::object m_logger;
+	enum class State
+	{
+		ACTIVE,
+		CLOSING,
+		CLOSED
+	};
 
 	/**
-	 * Calls boost::python::exec, but only if the Python iterpreter is still
-	 * initialized. This is necessary, as log messages may be issued in atexit()
-	 * at which point the Python interpreter is already half finalized, leading
-	 * to a SIGSEV.
+	 * Counts an event as in flight. Increment before checking the state, so
+	 * that close() sees every event that passed the check.
 	 */
-	static void python_safe_exec(const char* cmd, boost::python::dict& locals)
+	class InFlight
 	{
-		if (Py_IsInitialized()) {
-			boost::python::exec(cmd, boost::python::object(), locals);
+	public:
+		InFlight(pylogging::InFlightCounter& counter) : m_counter(counter)
+		{
+			m_counter.enter();
 		}
-	}
+
+		~InFlight()
+		{
+			m_counter.leave();
+		}
+
+	private:
+		pylogging::InFlightCounter& m_counter;
+	};
+
+	std::string m_domain;
+	/**
+	 * Python logger object, only to be accessed while holding the GIL. Kept
+	 * behind a pointer to be able to drop it without touching the reference
+	 * count once the interpreter is gone.
+	 */
+	std::unique_ptr<boost::python::object> m_logger;
+
+	std::atomic<State> m_state;
+	pylogging::InFlightCounter m_in_flight;
 
 	/**
 	 * Initializes the m_logger variable if this has not been done yet.
@@ -60,7 +168,7 @@ private:
 	void init()
 	{
 		// Abort if the logger has already been fetched
-		if (m_logger.ptr() != boost::python::object().ptr()) {
+		if (m_logger) {
 			return;
 		}
 
@@ -69,9 +177,11 @@ private:
 		locals["domain"] = m_domain;
 
 		// Fetch the logger
-		python_safe_exec("import logging\nlogger = logging.getLogger(domain)\n", locals);
+		boost::python::exec(
+		    "import logging\nlogger = logging.getLogger(domain)\n", boost::python::object(),
+		    locals);
 		if (locals.has_key("logger")) {
-			m_logger = locals["logger"];
+			m_logger.reset(new boost::python::object(locals["logger"]));
 		}
 	}
 
@@ -97,16 +207,21 @@ private:
 		return 10; // DEBUG
 	}
 
-public:
-	PythonLoggingAppenderImpl(const std::string& domain) : m_domain(domain) {}
-	void append(const spi::LoggingEventPtr& event)
+	void forward(const spi::LoggingEventPtr& event)
 	{
+		// Events may be issued from any thread, with or without the GIL held
+		pylogging::ScopedGILAcquire gil;
+
 		// Initialize logging
 		init();
+		if (!m_logger) {
+			return;
+		}
+		ForwardingGuard forwarding;
 
 		// Place all variables in the local variable dictionary
 		boost::python::dict locals;
-		locals["logger"] = m_logger;
+		locals["logger"] = *m_logger;
 		locals["level"] = convert_level(event->getLevel()->toInt());
 		locals["message"] = event->getMessage();
 
@@ -115,16 +230,70 @@ public:
 		std::string logger_name = event->getLoggerName();
 		if (!logger_name.empty()) {
 			locals["context"] = logger_name;
-			python_safe_exec("logger.getChild(context).log(level, message);", locals);
+			boost::python::exec(
+			    "logger.getChild(context).log(level, message);", boost::python::object(), locals);
 		} else {
-			python_safe_exec("logger.log(level, message);", locals);
+			boost::python::exec("logger.log(level, message);", boost::python::object(), locals);
 		}
 	}
 
+public:
+	PythonLoggingAppenderImpl(const std::string& domain) :
+	    m_domain(domain), m_state(State::ACTIVE)
+	{}
+
+	~PythonLoggingAppenderImpl()
+	{
+		close();
+	}
+
+	void append(const spi::LoggingEventPtr& event)
+	{
+		{
+			InFlight in_flight(m_in_flight);
+			if (m_state.load() != State::ACTIVE) {
+				return;
+			}
+			// Messages may be issued in atexit() or from threads outliving the
+			// interpreter, entering Python then leads to a SIGSEV.
+			pylogging::PythonEntry entry;
+			if (entry) {
+				try {
+					forward(event);
+				} catch (boost::python::error_already_set const&) {
+					pylogging::ScopedGILAcquire gil;
+					PyErr_Print();
+				}
+				return;
+			}
+		}
+		fallback_sink().write(event);
+	}
+
 	void close()
 	{
-		// Delete the reference to the logger
-		m_logger = boost::python::object();
+		State expected = State::ACTIVE;
+		if (!m_state.compare_exchange_strong(expected, State::CLOSING)) {
+			return;
+		}
+		{
+			// events in flight may be waiting for the GIL
+			pylogging::ScopedGILRelease nogil;
+			m_in_flight.wait_idle(drain_timeout);
+		}
+
+		if (m_logger) {
+			pylogging::PythonEntry entry;
+			if (entry) {
+				// Delete the reference to the logger
+				pylogging::ScopedGILAcquire gil;
+				m_logger.reset();
+			} else {
+				// Interpreter is gone, the object must not be touched anymore
+				m_logger.release();
+			}
+		}
+		m_state.store(State::CLOSED);
 	}
 
 	const std::string& domain() const { return m_domain; }
@@ -155,4 +324,14 @@ const std::string& PythonLoggingAppender::domain() const
 	return m_impl->domain();
 }
 
+bool PythonLoggingAppender::forwarding()
+{
+	return t_forwarding;
+}
+
+void PythonLoggingAppender::set_fallback_file(const std::string& filename)
+{
+	fallback_sink().set_file(filename);
+}
+
 } // namespace log4cxx
@@ -42,6 +42,9 @@ class PythonLoggingAppenderImpl;
 /**
  * Implements an adapter class which write log4cxx events to the Python
  * "logging" class.
+ *
+ * Events may be appended from any thread, also while the interpreter shuts
+ * down or after the appender has been closed.
  */
 class PythonLoggingAppender : public AppenderSkeleton
 {
@@ -86,5 +89,18 @@ public:
 	 * Returns the "domain" string given in the constructor.
 	 */
 	const std::string& domain() const;
+
+	/**
+	 * Returns whether the calling thread is currently forwarding an event to
+	 * Python. Used to break cycles with handlers routing Python logging back
+	 * into log4cxx.
+	 */
+	static bool forwarding();
+
+	/**
+	 * Sets the file events are written to once Python is gone (see
+	 * pylogging::PythonEntry), stderr if filename is empty.
+	 */
+	static void set_fallback_file(const std::string& filename);
 };
 } // namespace log4cxx
@@ -0,0 +1,270 @@
+/* boost::python still uses the global bind placeholders _1, _2, ...;
+ * to be removed as soon as boost::python is fixed (it isn't as of boost 1.77).
+ */
+#ifndef BOOST_BIND_GLOBAL_PLACEHOLDERS
+#define BOOST_BIND_GLOBAL_PLACEHOLDERS
+#endif
+
+#include <boost/python.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <log4cxx/spi/loggingevent.h>
+
+#include "gil.h"
+#include "pywriter.h"
+
+namespace {
+
+/// all alive buffered writers, flushed by the timer and at interpreter shutdown
+struct Registry
+{
+	std::mutex mutex;
+	std::set<PyWriter*> writers;
+
+	/// runs PyWriter::run_timer() while buffered writers exist, until flush_all()
+	std::thread timer;
+	std::condition_variable wakeup;
+	bool stopped = false;
+};
+
+Registry& registry()
+{
+	// leaked on purpose, writers may outlive static destruction
+	static Registry* instance = new Registry;
+	return *instance;
+}
+
+/// Level of the event whose line is written next by this thread, set by
+/// PyWriterLevelFilter. The event keeps the level alive until then.
+thread_local log4cxx::Level const* t_event_level = nullptr;
+
+/// lower bound of the timer period while no lines are pending
+constexpr std::chrono::milliseconds min_idle_period{10};
+
+} // anonymous namespace
+
+PyWriter::PyWriter(bool buffered, size_t flush_size, double flush_interval) :
+    m_buffered(buffered),
+    m_flush_size(flush_size),
+    m_flush_interval(std::chrono::duration_cast<clock_type::duration>(
+        std::chrono::duration<double>(flush_interval))),
+    m_flush_level(log4cxx::Level::ERROR_INT)
+{
+	if (m_buffered) {
+		m_buffer.reserve(m_flush_size);
+		// the timer holds the registry lock while waiting for the GIL
+		pylogging::ScopedGILRelease nogil;
+		Registry& reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		reg.writers.insert(this);
+		if (!reg.timer.joinable() && !reg.stopped) {
+			reg.timer = std::thread(&PyWriter::run_timer);
+		}
+	}
+}
+
+PyWriter::~PyWriter()
+{
+	if (m_buffered) {
+		// flush_all() holds the registry lock while waiting for the GIL
+		pylogging::ScopedGILRelease nogil;
+		{
+			std::lock_guard<std::mutex> lock(registry().mutex);
+			registry().writers.erase(this);
+		}
+		flush_buffer();
+	}
+}
+
+void PyWriter::close(log4cxx::helpers::Pool&)
+{
+	flush_buffer();
+}
+
+void PyWriter::flush(log4cxx::helpers::Pool&)
+{
+	// Thresholds are evaluated in write(), the appender's per-line flush is
+	// exactly what buffered mode avoids.
+}
+
+void PyWriter::write(const log4cxx::LogString& str, log4cxx::helpers::Pool&)
+{
+	if (!m_buffered) {
+		write_stdout(str.data(), str.size());
+		return;
+	}
+
+	log4cxx::Level const* const level = std::exchange(t_event_level, nullptr);
+	bool flush_now = level && (level->toInt() >= m_flush_level.load(std::memory_order_relaxed));
+	bool first_pending = false;
+	{
+		std::lock_guard<std::mutex> lock(m_buffer_mutex);
+		auto const now = clock_type::now();
+		if (m_buffer.empty()) {
+			m_first_pending = now;
+			first_pending = true;
+		}
+		m_buffer.append(str);
+		flush_now = flush_now || thresholds_reached(now);
+	}
+
+	if (flush_now) {
+		flush_buffer();
+	} else if (first_pending) {
+		// without the lock: a missed wakeup only delays until the next idle period
+		registry().wakeup.notify_one();
+	}
+}
+
+bool PyWriter::thresholds_reached(clock_type::time_point now) const
+{
+	return (m_buffer.size() >= m_flush_size) || (now - m_first_pending >= m_flush_interval);
+}
+
+void PyWriter::setFlushLevel(log4cxx::LevelPtr const& level)
+{
+	m_flush_level.store(level->toInt(), std::memory_order_relaxed);
+}
+
+log4cxx::LevelPtr PyWriter::getFlushLevel() const
+{
+	return log4cxx::Level::toLevel(m_flush_level.load(std::memory_order_relaxed));
+}
+
+PyWriter::clock_type::time_point PyWriter::flush_expired(clock_type::time_point now)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_buffer_mutex);
+		if (m_buffer.empty()) {
+			return clock_type::time_point::max();
+		}
+		if (now - m_first_pending < m_flush_interval) {
+			return m_first_pending + m_flush_interval;
+		}
+	}
+	flush_buffer();
+	return clock_type::time_point::max();
+}
+
+void PyWriter::run_timer()
+{
+	Registry& reg = registry();
+	std::unique_lock<std::mutex> lock(reg.mutex);
+	while (!reg.stopped) {
+		// Writers wake us up when their first line is pending, the idle period
+		// only covers a wakeup missed while scanning.
+		auto const now = clock_type::now();
+		auto next = clock_type::time_point::max();
+		for (PyWriter* writer : reg.writers) {
+			auto const idle =
+			    std::max<clock_type::duration>(writer->m_flush_interval, min_idle_period);
+			next = std::min({next, writer->flush_expired(now), now + idle});
+		}
+		if (next == clock_type::time_point::max()) {
+			reg.wakeup.wait(lock);
+		} else {
+			reg.wakeup.wait_until(lock, next);
+		}
+	}
+}
+
+void PyWriter::flush_buffer()
+{
+	// Waiting for m_write_mutex while holding the GIL would deadlock against a
+	// thread holding m_write_mutex and waiting for the GIL.
+	pylogging::ScopedGILRelease nogil;
+	std::lock_guard<std::mutex> write_lock(m_write_mutex);
+
+	std::string chunk;
+	{
+		std::lock_guard<std::mutex> lock(m_buffer_mutex);
+		if (m_buffer.empty()) {
+			return;
+		}
+		chunk.reserve(m_flush_size);
+		chunk.swap(m_buffer);
+	}
+	write_stdout(chunk.data(), chunk.size());
+}
+
+void PyWriter::write_stdout(char const* data, size_t size)
+{
+	pylogging::PythonEntry entry;
+	if (!entry) {
+		return;
+	}
+	// may be called from any thread, e.g. while pylogging's log() released the GIL
+	pylogging::ScopedGILAcquire gil;
+
+	// Unlike PySys_WriteStdout, neither truncates at 1000 bytes nor interprets
+	// format characters.
+	PyObject* out = PySys_GetObject("stdout"); // borrowed
+	if (out == nullptr || out == Py_None) {
+		return;
+	}
+	PyObject* text = PyUnicode_DecodeUTF8(data, static_cast<Py_ssize_t>(size), "replace");
+	if (text == nullptr) {
+		PyErr_Clear();
+		return;
+	}
+	PyObject* ret = PyObject_CallMethod(out, "write", "O", text);
+	Py_DECREF(text);
+	if (ret == nullptr) {
+		PyErr_Clear();
+		return;
+	}
+	Py_DECREF(ret);
+}
+
+void PyWriter::flush_all()
+{
+	pylogging::ScopedGILRelease nogil;
+	Registry& reg = registry();
+	std::thread timer;
+	{
+		std::lock_guard<std::mutex> lock(reg.mutex);
+		reg.stopped = true;
+		timer.swap(reg.timer);
+	}
+	reg.wakeup.notify_one();
+	if (timer.joinable()) {
+		timer.join();
+	}
+
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	for (PyWriter* writer : reg.writers) {
+		writer->flush_buffer();
+	}
+}
+
+log4cxx::spi::Filter::FilterDecision PyWriterLevelFilter::decide(
+    const log4cxx::spi::LoggingEventPtr& event) const
+{
+	// the appender calls its writer on this thread right after the filters
+	t_event_level = event->getLevel().get();
+	return log4cxx::spi::Filter::NEUTRAL;
+}
+
+void PyWriterLevelFilter::attach(log4cxx::AppenderSkeleton& appender)
+{
+	if (std::dynamic_pointer_cast<PyWriterLevelFilter>(appender.getFirstFilter())) {
+		return;
+	}
+
+	// Has to come first, later filters may stop the chain with ACCEPT.
+	std::vector<log4cxx::spi::FilterPtr> filters;
+	for (auto filter = appender.getFirstFilter(); filter; filter = filter->getNext()) {
+		filters.push_back(filter);
+	}
+	appender.clearFilters();
+	appender.addFilter(std::make_shared<PyWriterLevelFilter>());
+	for (auto const& filter : filters) {
+		appender.addFilter(filter);
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+/**
+ * @file pywriter.h
+ *
+ * log4cxx Writer forwarding formatted log lines to Python's sys.stdout, to be
+ * used with a ConsoleAppender, e.g. to play well with Jupyter notebooks.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+#include <log4cxx/appenderskeleton.h>
+#include <log4cxx/helpers/writer.h>
+#include <log4cxx/level.h>
+#include <log4cxx/spi/filter.h>
+
+class PyWriter : public log4cxx::helpers::Writer
+{
+public:
+	typedef std::chrono::steady_clock clock_type;
+
+	/**
+	 * @param buffered If false, every line is written to sys.stdout right away.
+	 *                 If true, lines are collected in a C++ buffer and written
+	 *                 in large chunks.
+	 * @param flush_size Buffered mode: write out once this many bytes are pending.
+	 * @param flush_interval Buffered mode: write out once the oldest pending
+	 *                       line is older than this many seconds. Checked when
+	 *                       the next line arrives and by a background thread
+	 *                       shared by all buffered writers.
+	 */
+	PyWriter(bool buffered = false, size_t flush_size = 64 * 1024, double flush_interval = 0.5);
+	~PyWriter();
+
+	void close(log4cxx::helpers::Pool&) override;
+	/// called by the appender after every line; only acts on thresholds in buffered mode
+	void flush(log4cxx::helpers::Pool&) override;
+	void write(const log4cxx::LogString& str, log4cxx::helpers::Pool&) override;
+
+	/// write out all pending lines
+	void flush_buffer();
+
+	/// Buffered mode: lines of events at or above level are written out
+	/// right away together with all pending lines, ERROR by default.
+	void setFlushLevel(log4cxx::LevelPtr const& level);
+	log4cxx::LevelPtr getFlushLevel() const;
+
+	bool buffered() const
+	{
+		return m_buffered;
+	}
+
+	/// Stop the background thread and write out the buffers of all buffered
+	/// writers, registered to run at interpreter shutdown.
+	static void flush_all();
+
+private:
+	void write_stdout(char const* data, size_t size);
+	bool thresholds_reached(clock_type::time_point now) const;
+
+	/// write out pending lines older than the flush interval
+	/// @return when to check again, time_point::max() if nothing is pending
+	clock_type::time_point flush_expired(clock_type::time_point now);
+
+	/// background thread writing out lines once flush_interval expired
+	static void run_timer();
+
+	bool const m_buffered;
+	size_t const m_flush_size;
+	clock_type::duration const m_flush_interval;
+
+	std::atomic<int> m_flush_level;
+
+	/// guards m_buffer and m_first_pending
+	std::mutex m_buffer_mutex;
+	std::string m_buffer;
+	clock_type::time_point m_first_pending;
+
+	/// keeps chunks in order; never held while waiting for the GIL
+	std::mutex m_write_mutex;
+};
+
+LOG4CXX_PTR_DEF(PyWriter);
+
+/**
+ * Filter that never rejects events, but tells PyWriter::write() the level of
+ * the event whose line it is about to write; Writers only see the formatted
+ * string. Put in front of the filters of every appender a PyWriter is set on,
+ * see attach().
+ */
+class PyWriterLevelFilter : public log4cxx::spi::Filter
+{
+public:
+	FilterDecision decide(const log4cxx::spi::LoggingEventPtr& event) const override;
+
+	void activateOptions(log4cxx::helpers::Pool&) override {}
+	void setOption(const log4cxx::LogString&, const log4cxx::LogString&) override {}
+
+	/// make sure appender's first filter is a PyWriterLevelFilter
+	static void attach(log4cxx::AppenderSkeleton& appender);
+};
+
+LOG4CXX_PTR_DEF(PyWriterLevelFilter);
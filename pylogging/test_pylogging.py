@@ -117,6 +117,22 @@ INFO  xyz.test INFO
 """
             self.assertEqualLogLines(expected, f.read())
 
+    def test_default_config_fanout(self):
+        log = os.path.join(self.temp, 'test_default_config_fanout.log')
+
+        logger.default_config(logger.LogLevel.INFO, log, date_format="ISO8601",
+                fanout=True)
+        logger.default_config(logger.LogLevel.INFO, log, date_format="ISO8601",
+                fanout=True)
+        # console and file share one appender, repeated calls replace it
+        self.assertEqual(1, logger.get_root().get_number_of_appenders())
+
+        logger.LOG4CXX_INFO(logger.get("test"), "INFO")
+        logger.LOG4CXX_DEBUG(logger.get("test"), "DEBUG")
+        logger.reset()
+        with open(log) as f:
+            self.assertEqualLogLines("INFO  test INFO\n", f.read())
+
     def test_default_logger(self):
         log_all = os.path.join(self.temp, 'test_default_logger_all.log')
         log_default = os.path.join(self.temp, 'test_default_logger_default.log')
@@ -233,6 +249,227 @@ ERROR xyz.test ERROR
 """
             self.assertEqualLogLines(expected, f.read())
 
+    def test_file_logging_from_threads(self):
+        import threading
+
+        log = os.path.join(self.temp, 'test_file_logging_from_threads.log')
+        logger.log_to_file(log, logger.LogLevel.INFO)
+
+        n_threads, n_messages = 8, 200
+
+        def work(index):
+            l = logger.get("thread{}".format(index))
+            for i in range(n_messages):
+                l.INFO("message {}".format(i))
+
+        threads = [threading.Thread(target=work, args=(i,))
+                   for i in range(n_threads)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+        logger.reset()
+        with open(log) as f:
+            lines = f.read().splitlines()
+        self.assertEqual(n_threads * n_messages, len(lines))
+        for i in range(n_threads):
+            self.assertEqual(
+                n_messages,
+                sum(1 for l in lines if " thread{} ".format(i) in l))
+
+    def test_file_logging_json(self):
+        import json
+
+        log = os.path.join(self.temp, 'test_file_logging_json.log')
+        logger.set_loglevel(logger.get_root(), logger.LogLevel.INFO)
+        logger.write_to_file(log, json=True)
+
+        l = logger.get("json")
+        logger.LOG4CXX_INFO(l, 'first line\nsecond "line"')
+        logger.LOG4CXX_DEBUG(l, "not logged")
+        logger.LOG4CXX_WARN(l, "tab\there")
+
+        logger.reset()
+        with open(log) as f:
+            records = [json.loads(line) for line in f]
+        self.assertEqual(2, len(records))
+        self.assertEqual('first line\nsecond "line"', records[0]["message"])
+        self.assertEqual("INFO", records[0]["level"])
+        self.assertEqual("json", records[0]["logger"])
+        self.assertEqual(os.getpid(), records[0]["pid"])
+        self.assertIsInstance(records[0]["time_ns"], int)
+        self.assertLessEqual(records[0]["time_ns"], records[1]["time_ns"])
+        self.assertEqual("tab\there", records[1]["message"])
+
+    def test_capture(self):
+        l = logger.get("capture")
+        logger.set_loglevel(l, logger.LogLevel.DEBUG)
+
+        with logger.capture(l, capacity=2, level=logger.LogLevel.INFO) as captured:
+            logger.LOG4CXX_DEBUG(l, "below threshold")
+            for i in range(3):
+                logger.LOG4CXX_INFO(l, "message {}".format(i))
+        logger.LOG4CXX_INFO(l, "after capture")
+
+        self.assertEqual(2, len(captured))
+        self.assertEqual(["message 1", "message 2"], captured.messages())
+        event = captured.events()[-1]
+        self.assertEqual("message 2", event.message)
+        self.assertEqual("capture", event.logger)
+        self.assertEqual(logger.LogLevel.INFO, event.level)
+        self.assertGreater(event.timestamp, 0)
+        self.assertEqual(0, l.get_number_of_appenders())
+
+        captured.clear()
+        self.assertEqual([], captured.messages())
+
+        # truncated at 1024 bytes without splitting a character
+        with logger.capture(l) as captured:
+            logger.LOG4CXX_INFO(l, "x" + "\u00e4" * 1000)
+        self.assertEqual("x" + "\u00e4" * 511, captured.messages()[0])
+        self.assertEqual(captured.messages()[0], captured.events()[0].message)
+
+    def test_pywriter_from_threads(self):
+        import threading
+
+        appender = logger.log_to_cout(logger.LogLevel.INFO)
+        appender.setWriter(logger.PyWriter())
+
+        def work():
+            l = logger.get("pywriter")
+            for i in range(100):
+                l.INFO("message {}".format(i))
+
+        threads = [threading.Thread(target=work) for i in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+    def test_pywriter_buffered(self):
+        import io
+        import sys
+
+        out = io.StringIO()
+        self.addCleanup(setattr, sys, "stdout", sys.stdout)
+        sys.stdout = out
+
+        appender = logger.log_to_cout(logger.LogLevel.INFO)
+        writer = logger.PyWriter(buffered=True, flush_interval=3600)
+        self.assertTrue(writer.buffered)
+        appender.setWriter(writer)
+
+        l = logger.get("pywriter")
+        long_message = "x" * 5000
+        l.INFO("100% of %s")
+        l.INFO(long_message)
+        self.assertEqual("", out.getvalue())
+
+        l.ERROR("error")
+        lines = out.getvalue().splitlines()
+        self.assertEqual(3, len(lines))
+        self.assertTrue(lines[0].endswith("pywriter 100% of %s"))
+        self.assertTrue(lines[1].endswith(long_message))
+        self.assertTrue(lines[2].endswith("pywriter error"))
+
+        l.INFO("pending")
+        self.assertEqual(3, len(out.getvalue().splitlines()))
+        writer.flush()
+        self.assertEqual(4, len(out.getvalue().splitlines()))
+
+    def test_pywriter_buffered_flush_interval(self):
+        import io
+        import sys
+        import time
+
+        out = io.StringIO()
+        self.addCleanup(setattr, sys, "stdout", sys.stdout)
+        sys.stdout = out
+
+        appender = logger.log_to_cout(logger.LogLevel.INFO)
+        writer = logger.PyWriter(buffered=True, flush_interval=0.1)
+        writer.setFlushLevel(logger.LogLevel.FATAL)
+        appender.setWriter(writer)
+
+        # written by the background thread, no further line arrives
+        logger.get("pywriter").ERROR("idle")
+        deadline = time.time() + 10
+        while not out.getvalue() and time.time() < deadline:
+            time.sleep(0.01)
+        self.assertTrue(out.getvalue().rstrip().endswith("pywriter idle"))
+
+    def test_pywriter_buffered_flush_size(self):
+        import io
+        import sys
+
+        out = io.StringIO()
+        self.addCleanup(setattr, sys, "stdout", sys.stdout)
+        sys.stdout = out
+
+        appender = logger.log_to_cout(logger.LogLevel.INFO)
+        writer = logger.PyWriter(buffered=True, flush_size=1024,
+                                 flush_interval=3600)
+        appender.setWriter(writer)
+
+        l = logger.get("pywriter")
+        for i in range(100):
+            l.INFO("message {}".format(i))
+        written = len(out.getvalue().splitlines())
+        self.assertGreater(written, 0)
+        self.assertLess(written, 100)
+        writer.flush()
+        self.assertEqual(100, len(out.getvalue().splitlines()))
+
+    def test_log_batch(self):
+        import array
+
+        log = os.path.join(self.temp, 'test_log_batch.log')
+        logger.log_to_file(log, logger.LogLevel.INFO)
+
+        l = logger.get("batch")
+        logger.log_batch(l, logger.LogLevel.INFO, ["a", 1, 2.5])
+        l.log_batch(logger.LogLevel.DEBUG, ["disabled"])
+        l.log_batch(logger.LogLevel.WARN, "{{i}}={} v={} s={}",
+                    array.array('i', [1, -2]), array.array('d', [0.5, 1e-3]),
+                    ["x", "y"])
+        with self.assertRaises(ValueError):
+            l.log_batch(logger.LogLevel.WARN, "{} {}",
+                        array.array('i', [1, 2]), [1])
+        with self.assertRaises(TypeError):
+            l.log_batch(logger.LogLevel.WARN, "single message")
+
+        logger.reset()
+        with open(log) as f:
+            expected = \
+"""INFO  batch a
+INFO  batch 1
+INFO  batch 2.5
+WARN  batch {i}=1 v=0.5 s=x
+WARN  batch {i}=-2 v=0.001 s=y
+"""
+            self.assertEqualLogLines(expected, f.read())
+
+    def test_log_batch_numpy(self):
+        try:
+            import numpy as np
+        except ImportError:
+            self.skipTest("numpy not available")
+
+        log = os.path.join(self.temp, 'test_log_batch_numpy.log')
+        logger.log_to_file(log, logger.LogLevel.INFO)
+
+        values = np.arange(1000, dtype=np.int64)
+        logger.log_batch(logger.get("batch"), logger.LogLevel.INFO,
+                         "element {}: {}", values, values[::-1] * 0.5)
+
+        logger.reset()
+        with open(log) as f:
+            lines = f.read().splitlines()
+        self.assertEqual(1000, len(lines))
+        self.assertTrue(lines[0].endswith("batch element 0: 499.5"))
+        self.assertTrue(lines[-1].endswith("batch element 999: 0"))
+
     def test_config_from_file(self):
         import inspect
 
@@ -399,5 +636,124 @@ log4j.appender.A1.layout.ConversionPattern=%Y%-5p %y%c %m\\n  -> [33m%F[0m:[3
             {'msg': 'msg1', 'levelno': 50, 'name': 'root2.test1'},
         ], records)
 
+    def test_log4cxx_handler(self):
+        import logging
+
+        log = os.path.join(self.temp, 'test_log4cxx_handler.log')
+        logger.log_to_file(log, logger.LogLevel.DEBUG)
+
+        handler = logger.Log4cxxHandler()
+        self.assertIsInstance(handler, logging.Handler)
+        py_logger = logging.getLogger("stdlib.test")
+        py_logger.addHandler(handler)
+        self.addCleanup(py_logger.removeHandler, handler)
+        py_logger.propagate = False
+        py_logger.setLevel(logging.NOTSET)
+        logger.set_loglevel(logger.get("stdlib.test"), logger.LogLevel.INFO)
+
+        py_logger.critical("critical")
+        py_logger.error("error %d%%", 42)
+        py_logger.warning("warning")
+        py_logger.info("info")
+        py_logger.debug("debug")
+        try:
+            raise RuntimeError("boom")
+        except RuntimeError:
+            py_logger.exception("exception")
+
+        logger.reset()
+        with open(log) as f:
+            lines = f.read().splitlines()
+        expected = [
+            "FATAL stdlib.test critical",
+            "ERROR stdlib.test error 42%",
+            "WARN  stdlib.test warning",
+            "INFO  stdlib.test info",
+            "ERROR stdlib.test exception",
+        ]
+        self.assertEqualLogLines("\n".join(expected),
+                                 "\n".join(lines[:len(expected)]))
+        self.assertEqual("Traceback (most recent call last):",
+                         lines[len(expected)])
+        self.assertEqual("RuntimeError: boom", lines[-1])
+
+    def test_log4cxx_handler_error(self):
+        import contextlib
+        import io
+        import logging
+
+        handler = logger.Log4cxxHandler()
+        py_logger = logging.getLogger("stdlib.error")
+        py_logger.addHandler(handler)
+        self.addCleanup(py_logger.removeHandler, handler)
+        py_logger.propagate = False
+        logger.set_loglevel(logger.get("stdlib.error"), logger.LogLevel.INFO)
+
+        # reported by logging.Handler.handleError with the traceback
+        stderr = io.StringIO()
+        with contextlib.redirect_stderr(stderr):
+            py_logger.error("%d", "not a number")
+        self.assertIn("--- Logging error ---", stderr.getvalue())
+        self.assertIn("Traceback (most recent call last):", stderr.getvalue())
+        self.assertIn("TypeError", stderr.getvalue())
+
+    def test_log4cxx_handler_no_cycle(self):
+        import logging
+        records = []
+        class Handler(logging.Handler):
+            def emit(self, record):
+                records.append(record.getMessage())
+
+        root_logger = logging.getLogger("")
+        handlers = [Handler(), logger.Log4cxxHandler()]
+        for h in handlers:
+            root_logger.addHandler(h)
+            self.addCleanup(root_logger.removeHandler, h)
+        root_logger.setLevel(logging.NOTSET)
+
+        # log4cxx -> logging -> Log4cxxHandler must not reach log4cxx again
+        logger.append_to_logging("root")
+        logger.get("cycle").WARN("msg")
+        self.assertEqual(["msg"], records)
+
+    def test_append_to_logging_during_shutdown(self):
+        import subprocess
+        import sys
+
+        fallback = os.path.join(self.temp, 'fallback.log')
+        script = """
+import logging
+import pylogging
+import _pylogging_testing
+logging.getLogger().addHandler(logging.NullHandler())
+pylogging.set_logging_fallback({fallback!r})
+pylogging.append_to_logging("root")
+pylogging.set_loglevel(pylogging.get_root(), pylogging.LogLevel.INFO)
+_pylogging_testing.log_from_native_threads(pylogging.get("stress"), 8)
+""".format(fallback=fallback)
+
+        # interpreter finalizes while native threads keep logging
+        for i in range(5):
+            ret = subprocess.run([sys.executable, "-c", script],
+                                 stdout=subprocess.PIPE,
+                                 stderr=subprocess.PIPE, timeout=60)
+            self.assertEqual(0, ret.returncode, ret.stderr.decode())
+
+    def test_append_to_logging_reset_under_load(self):
+        import logging
+        import _pylogging_testing
+        logging.getLogger().addHandler(logging.NullHandler())
+
+        logger.append_to_logging("root")
+        logger.set_loglevel(logger.get_root(), logger.LogLevel.INFO)
+        _pylogging_testing.log_from_native_threads(logger.get("stress"), 4)
+        self.addCleanup(_pylogging_testing.join_native_threads)
+        for i in range(20):
+            logger.reset()
+            logger.append_to_logging("root")
+            logger.set_loglevel(logger.get_root(), logger.LogLevel.INFO)
+        _pylogging_testing.join_native_threads()
+        logger.reset()
+
 if __name__ == '__main__':
     unittest.main()
@@ -1,4 +1,5 @@
 #include "logger/deprecated/logger.h"
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 
@@ -88,6 +89,217 @@ std::string LogStream::str()
 }
 
 
+// -------------------------
+// Class LogLine
+// -------------------------
+
+namespace {
+
+//! Reset streams of the calling thread, reused by LogLine
+struct LogStreamPool
+{
+	static size_t const capacity = 8;
+
+	LogStream* streams[capacity];
+	size_t size;
+
+	LogStreamPool() : size(0) {}
+
+	~LogStreamPool()
+	{
+		while (size > 0) {
+			// empty streams write nothing on destruction
+			streams[--size]->setstate(std::ios_base::badbit);
+			delete streams[size];
+		}
+	}
+};
+
+thread_local LogStreamPool stream_pool;
+
+} // namespace
+
+LogLine::~LogLine()
+{
+	if (stream)
+		release(stream);
+}
+
+LogLine& LogLine::operator=(LogLine&& other)
+{
+	if (this != &other) {
+		if (stream)
+			release(stream);
+		stream = other.stream;
+		other.stream = NULL;
+	}
+	return *this;
+}
+
+LogStream* LogLine::acquire()
+{
+	if (stream_pool.size > 0)
+		return stream_pool.streams[--stream_pool.size];
+	return new LogStream;
+}
+
+void LogLine::release(LogStream* stream)
+{
+	stream->writeOut();
+	stream->reset();
+	if (stream_pool.size < LogStreamPool::capacity) {
+		stream_pool.streams[stream_pool.size++] = stream;
+	} else {
+		stream->setstate(std::ios_base::badbit);
+		delete stream;
+	}
+}
+
+// -------------------------
+// Class LogWriter
+// -------------------------
+
+namespace {
+
+enum WriterState { WRITER_IDLE, WRITER_RUNNING, WRITER_STOPPED };
+
+std::atomic<int> writer_state(WRITER_IDLE);
+
+void stop_log_writer()
+{
+	LogWriter::instance().stop();
+}
+
+} // namespace
+
+LogWriter& LogWriter::instance()
+{
+	// leaked on purpose, lines may still be logged during static destruction
+	static LogWriter* writer = new LogWriter;
+	return *writer;
+}
+
+LogWriter::LogWriter() : lines(NULL), running(false), sleeping(false) {}
+
+void LogWriter::push(std::string const& text)
+{
+#ifndef PYPLUSPLUS
+	if (!running.load(std::memory_order_acquire))
+	{
+		boost::mutex::scoped_lock lock(thread_mutex);
+		if (writer_state.load() == WRITER_IDLE)
+		{
+			thread = boost::thread(&LogWriter::run, this);
+			writer_state.store(WRITER_RUNNING);
+			running.store(true, std::memory_order_release);
+			// drain before the log file is destroyed
+			std::atexit(stop_log_writer);
+		}
+		else if (writer_state.load() == WRITER_STOPPED)
+		{
+			Line* line = new Line;
+			line->next = NULL;
+			line->text = text;
+			write(line);
+			return;
+		}
+	}
+
+	Line* line = new Line;
+	line->next = lines.load(std::memory_order_relaxed);
+	line->text = text;
+	while (!lines.compare_exchange_weak(
+		line->next, line, std::memory_order_seq_cst, std::memory_order_relaxed)) {}
+	if (writer_state.load() == WRITER_STOPPED)
+	{
+		// stop() may have taken the final batch before this line arrived;
+		// the writer thread is joined once the lock is ours
+		boost::mutex::scoped_lock lock(thread_mutex);
+		write(lines.exchange(NULL));
+		return;
+	}
+	if (sleeping.load(std::memory_order_acquire))
+		wakeup.notify_one();
+#else // PYPLUSPLUS
+	Line* line = new Line;
+	line->next = NULL;
+	line->text = text;
+	write(line);
+#endif // PYPLUSPLUS
+}
+
+void LogWriter::stop()
+{
+#ifndef PYPLUSPLUS
+	boost::mutex::scoped_lock lock(thread_mutex);
+	if (writer_state.load() == WRITER_RUNNING)
+	{
+		running.store(false, std::memory_order_release);
+		writer_state.store(WRITER_STOPPED);
+		wakeup.notify_one();
+		thread.join();
+	}
+	writer_state.store(WRITER_STOPPED);
+	// lines pushed while stopping, later ones are written by their producers
+	write(lines.exchange(NULL));
+#endif // PYPLUSPLUS
+}
+
+void LogWriter::run()
+{
+#ifndef PYPLUSPLUS
+	while (true)
+	{
+		Line* batch = lines.exchange(NULL, std::memory_order_acquire);
+		if (batch)
+		{
+			write(batch);
+			continue;
+		}
+		if (writer_state.load() != WRITER_RUNNING)
+			break;
+
+		boost::unique_lock<boost::mutex> lock(wakeup_mutex);
+		sleeping.store(true);
+		// producers notify without the lock, a missed wakeup only delays
+		if (!lines.load() && writer_state.load() == WRITER_RUNNING)
+			wakeup.timed_wait(lock, boost::posix_time::milliseconds(10));
+		sleeping.store(false);
+	}
+#endif // PYPLUSPLUS
+}
+
+void LogWriter::write(Line* batch)
+{
+	if (!batch)
+		return;
+
+	// the list is newest first
+	Line* ordered = NULL;
+	while (batch)
+	{
+		Line* next = batch->next;
+		batch->next = ordered;
+		ordered = batch;
+		batch = next;
+	}
+
+	std::ostream& out = Logger::getLogfile().is_open() ? Logger::getLogfile() : std::cout;
+	bool const dual = Logger::getLogdual() && (&out != &std::cout);
+	for (Line* line = ordered; line;)
+	{
+		out << line->text;
+		if (dual)
+			std::cout << line->text;
+		Line* next = line->next;
+		delete line;
+		line = next;
+	}
+	out.flush();
+	if (dual)
+		std::cout.flush();
+}
+
 // -------------------------
 // Class Logger
 // -------------------------
@@ -99,6 +311,8 @@ Logger::Logger(size_t level, std::string filename, bool dual) :
 {
 	bool logdual = getLogdual();
 	logdual = dual;
+	// reference of monotonic timestamps
+	LogTimestamp::start();
 	getDeafstream().setstate(std::ios_base::eofbit);
 	resetStream(new LogStream);
 	loglevel.reset(new size_t(level));
@@ -124,6 +338,7 @@ Logger::Logger(Logger const&) : static_loglevel(DEFAULT_LOG_THRESHOLD) {}
 Logger::~Logger()
 {
 	resetStream(NULL);
+	LogWriter::instance().stop();
 	if (getLogfile().is_open()) {
 		getLogfile().flush();
 		getLogfile().close();
@@ -162,10 +377,23 @@ LogStream& Logger::operator() (size_t level)
 {
 	if(willBeLogged(level))
 		return resetStreamLevel(level);
-	resetStream(NULL);
+	// end the previous line without giving up the stream, continuations are ignored
+	if (local_stream.get()) {
+		local_stream->writeOut();
+		local_stream->setstate(std::ios_base::badbit);
+	}
 	return getDeafstream();
 }
 
+LogLine Logger::line(size_t level)
+{
+	if (!willBeLogged(level))
+		return LogLine();
+	LogLine ret(LogLine::acquire());
+	formatStream(*ret.stream, level);
+	return ret;
+}
+
 LogStream& Logger::flush(LogStream& stream)
 {
 	return stream.flush(stream);
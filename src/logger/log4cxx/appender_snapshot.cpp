@@ -0,0 +1,175 @@
+#include "logger/log4cxx/appender_snapshot.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include <log4cxx/logmanager.h>
+#include <log4cxx/spi/hierarchyeventlistener.h>
+#include <log4cxx/spi/loggerrepository.h>
+
+namespace visionary_logger {
+
+std::atomic<uint64_t> detail::appender_generation{0};
+
+namespace {
+
+/// invalidates all snapshots whenever log4cxx reports a change
+class SnapshotInvalidator :
+    public virtual log4cxx::spi::HierarchyEventListener,
+    public virtual log4cxx::helpers::Object
+{
+public:
+	DECLARE_LOG4CXX_OBJECT(SnapshotInvalidator)
+	BEGIN_LOG4CXX_CAST_MAP()
+	LOG4CXX_CAST_ENTRY(log4cxx::spi::HierarchyEventListener)
+	END_LOG4CXX_CAST_MAP()
+
+	void addAppenderEvent(const log4cxx::Logger*, const log4cxx::Appender*) override
+	{
+		appenders_changed();
+	}
+
+	void removeAppenderEvent(const log4cxx::Logger*, const log4cxx::Appender*) override
+	{
+		appenders_changed();
+	}
+};
+
+IMPLEMENT_LOG4CXX_OBJECT(SnapshotInvalidator)
+
+typedef std::unordered_map<log4cxx::Logger const*, AppenderChainPtr> Chains;
+
+/// snapshots shared by all threads, loggers of the hierarchy are never destroyed
+struct SharedChains
+{
+	std::mutex mutex;
+	uint64_t generation = 0;
+	Chains chains;
+};
+
+/// A snapshot used by the calling thread. Only the shared registry owns the chain, so appenders
+/// removed from the configuration are not kept alive by threads that stopped logging.
+struct LocalChain
+{
+	std::weak_ptr<AppenderChain const> chain;
+	detail::ChainSummary summary;
+};
+
+/// snapshots used by the calling thread
+struct LocalChains
+{
+	uint64_t generation = UINT64_MAX;
+	std::unordered_map<log4cxx::Logger const*, LocalChain> chains;
+	/// most threads check the same logger over and over
+	log4cxx::Logger const* last_logger = nullptr;
+	LocalChain* last_chain = nullptr;
+};
+
+thread_local LocalChains local_chains;
+
+AppenderChainPtr build_chain(log4cxx::Logger const* logger)
+{
+	auto chain = std::make_shared<AppenderChain>();
+	chain->appenders = logger->getAllAppenders();
+	chain->own = chain->appenders.size();
+	if (logger->getAdditivity()) {
+		for (log4cxx::LoggerPtr parent = logger->getParent(); parent;
+		     parent = parent->getParent()) {
+			log4cxx::AppenderList const appenders = parent->getAllAppenders();
+			chain->appenders.insert(chain->appenders.end(), appenders.begin(), appenders.end());
+			if (!parent->getAdditivity()) {
+				break;
+			}
+		}
+	}
+	return chain;
+}
+
+AppenderChainPtr shared_chain(log4cxx::Logger const* logger, uint64_t generation)
+{
+	// changes are tracked from the first snapshot on
+	static std::once_flag listening;
+	std::call_once(listening, [] {
+		log4cxx::LogManager::getLoggerRepository()->addHierarchyEventListener(
+		    log4cxx::spi::HierarchyEventListenerPtr(new SnapshotInvalidator));
+	});
+
+	static SharedChains shared;
+	std::lock_guard<std::mutex> lock(shared.mutex);
+	if (generation > shared.generation) {
+		shared.chains.clear();
+		shared.generation = generation;
+	} else if (generation < shared.generation) {
+		// the caller is about to see the newer generation
+		return build_chain(logger);
+	}
+	AppenderChainPtr& chain = shared.chains[logger];
+	if (!chain) {
+		// a change while building increments the generation, the chain is rebuilt on next use
+		chain = build_chain(logger);
+	}
+	return chain;
+}
+
+LocalChain& local_chain(log4cxx::Logger const* logger)
+{
+	LocalChains& local = local_chains;
+	uint64_t const generation = detail::appender_generation.load(std::memory_order_acquire);
+	if (local.generation != generation) {
+		local.chains.clear();
+		local.generation = generation;
+		local.last_logger = nullptr;
+	} else if (local.last_logger == logger) {
+		return *local.last_chain;
+	}
+
+	auto const inserted = local.chains.emplace(logger, LocalChain());
+	LocalChain& chain = inserted.first->second;
+	if (inserted.second) {
+		AppenderChainPtr const shared = shared_chain(logger, generation);
+		chain.chain = shared;
+		chain.summary.own = shared->own;
+		chain.summary.total = shared->appenders.size();
+	}
+	local.last_logger = logger;
+	local.last_chain = &chain;
+	return chain;
+}
+
+} // namespace
+
+detail::ChainSummary const& detail::chain_summary(log4cxx::Logger const* logger)
+{
+	return local_chain(logger).summary;
+}
+
+AppenderChainPtr appender_chain(log4cxx::LoggerPtr const& logger)
+{
+	LocalChain& local = local_chain(logger.get());
+	AppenderChainPtr chain = local.chain.lock();
+	if (!chain) {
+		// built outside the registry while a newer generation was published
+		chain = shared_chain(logger.get(), local_chains.generation);
+		local.chain = chain;
+	}
+	return chain;
+}
+
+bool has_appenders(log4cxx::LoggerPtr const& logger)
+{
+	if (detail::chain_summary(logger.get()).own != 0) {
+		// removals are not reported by log4cxx, attached means the snapshot is still right
+		AppenderChainPtr const chain = appender_chain(logger);
+		if (chain->own != 0 && logger->isAttached(chain->appenders.front())) {
+			return true;
+		}
+	}
+	// callers act on "not configured", e.g. by adding appenders, so it is confirmed as well
+	bool const configured = !logger->getAllAppenders().empty();
+	if (configured != (detail::chain_summary(logger.get()).own != 0)) {
+		appenders_changed();
+	}
+	return configured;
+}
+
+} // namespace visionary_logger
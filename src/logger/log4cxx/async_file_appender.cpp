@@ -0,0 +1,61 @@
+#include "logger/log4cxx/async_file_appender.h"
+
+#include <cstring>
+#include <mutex>
+
+#include <log4cxx/helpers/loglog.h>
+#include <log4cxx/layout.h>
+#include <log4cxx/spi/loggingevent.h>
+
+namespace log4cxx {
+
+AsyncFileAppender::AsyncFileAppender(
+    LayoutPtr const& layout,
+    std::string const& filename,
+    bool append,
+    logger::AsyncFile::Backend backend) :
+    m_file(new logger::AsyncFile(filename, append, backend))
+{
+	setLayout(layout);
+	setName("ASYNCFILE");
+}
+
+AsyncFileAppender::~AsyncFileAppender()
+{
+	close();
+}
+
+void AsyncFileAppender::close()
+{
+	// events being appended complete first, later ones see closed
+	std::lock_guard<decltype(mutex)> lock(mutex);
+	if (closed) {
+		return;
+	}
+	closed = true;
+	m_file->close();
+	if (m_file->dropped() != 0) {
+		helpers::LogLog::warn(
+		    LogString(LOG4CXX_STR("AsyncFileAppender: dropped ")) +
+		    std::to_string(m_file->dropped()) + " events");
+	}
+	if (m_file->error() != 0) {
+		helpers::LogLog::error(
+		    LogString(LOG4CXX_STR("AsyncFileAppender: ")) + std::strerror(m_file->error()));
+	}
+}
+
+void AsyncFileAppender::flush()
+{
+	m_file->flush();
+}
+
+void AsyncFileAppender::append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool)
+{
+	m_buffer.clear();
+	layout->format(m_buffer, event, pool);
+	// a full writer counts the event as dropped
+	m_file->write(m_buffer.data(), m_buffer.size());
+}
+
+} // namespace log4cxx
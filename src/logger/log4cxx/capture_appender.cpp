@@ -0,0 +1,149 @@
+#include "logger/log4cxx/capture_appender.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <log4cxx/spi/loggingevent.h>
+
+namespace log4cxx {
+
+namespace {
+
+/// longer logger names are truncated
+size_t const logger_name_size = 128;
+
+/// length of str cut to at most max_size bytes without splitting a UTF-8 sequence
+size_t truncated_length(LogString const& str, size_t max_size)
+{
+	if (str.size() <= max_size) {
+		return str.size();
+	}
+	size_t length = max_size;
+	// back off continuation bytes (10xxxxxx) to the start of the cut sequence
+	while (length > 0 && (static_cast<unsigned char>(str[length]) & 0xc0) == 0x80) {
+		--length;
+	}
+	return length;
+}
+
+} // namespace
+
+struct CaptureAppender::Slot
+{
+	int64_t timestamp;
+	LevelPtr level;
+	char* logger;
+	size_t logger_length;
+	char* message;
+	size_t message_length;
+};
+
+CaptureAppender::CaptureAppender(size_t capacity, LevelPtr const& threshold, size_t message_size) :
+    m_capacity(capacity),
+    m_message_size(message_size),
+    m_slots(new Slot[capacity]),
+    m_storage(new char[capacity * (logger_name_size + message_size)]),
+    m_total(0)
+{
+	if (capacity == 0) {
+		throw std::invalid_argument("CaptureAppender requires a capacity of at least one event");
+	}
+	char* storage = m_storage.get();
+	for (size_t i = 0; i < m_capacity; ++i) {
+		m_slots[i].timestamp = 0;
+		m_slots[i].logger = storage;
+		m_slots[i].logger_length = 0;
+		storage += logger_name_size;
+		m_slots[i].message = storage;
+		m_slots[i].message_length = 0;
+		storage += m_message_size;
+	}
+	setThreshold(threshold);
+}
+
+CaptureAppender::~CaptureAppender()
+{
+	close();
+}
+
+void CaptureAppender::close()
+{
+	closed = true;
+}
+
+void CaptureAppender::append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool&)
+{
+	LogString const& logger = event->getLoggerName();
+	LogString const& message = event->getRenderedMessage();
+
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+	Slot& slot = m_slots[m_total % m_capacity];
+	slot.timestamp = event->getTimeStamp();
+	slot.level = event->getLevel();
+	slot.logger_length = truncated_length(logger, logger_name_size);
+	std::memcpy(slot.logger, logger.data(), slot.logger_length);
+	slot.message_length = truncated_length(message, m_message_size);
+	std::memcpy(slot.message, message.data(), slot.message_length);
+	++m_total;
+}
+
+CaptureAppender::Slot const& CaptureAppender::slot(size_t i) const
+{
+	size_t const first = (m_total > m_capacity) ? m_total - m_capacity : 0;
+	return m_slots[(first + i) % m_capacity];
+}
+
+void CaptureAppender::copy(Slot const& slot, CapturedEvent& event) const
+{
+	event.timestamp = slot.timestamp;
+	event.level = slot.level;
+	event.logger.assign(slot.logger, slot.logger_length);
+	event.message.assign(slot.message, slot.message_length);
+}
+
+std::vector<CapturedEvent> CaptureAppender::events() const
+{
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+	std::vector<CapturedEvent> ret(std::min(m_total, m_capacity));
+	for (size_t i = 0; i < ret.size(); ++i) {
+		copy(slot(i), ret[i]);
+	}
+	return ret;
+}
+
+std::vector<std::string> CaptureAppender::messages() const
+{
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+	std::vector<std::string> ret(std::min(m_total, m_capacity));
+	for (size_t i = 0; i < ret.size(); ++i) {
+		Slot const& s = slot(i);
+		ret[i].assign(s.message, s.message_length);
+	}
+	return ret;
+}
+
+size_t CaptureAppender::size() const
+{
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+	return std::min(m_total, m_capacity);
+}
+
+size_t CaptureAppender::capacity() const
+{
+	return m_capacity;
+}
+
+size_t CaptureAppender::total() const
+{
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+	return m_total;
+}
+
+void CaptureAppender::clear()
+{
+	std::lock_guard<std::mutex> lock(m_ring_mutex);
+	m_total = 0;
+}
+
+} // namespace log4cxx
@@ -0,0 +1,484 @@
+#include "logger/log4cxx/compiled_config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+
+#include <log4cxx/consoleappender.h>
+#include <log4cxx/fileappender.h>
+#include <log4cxx/level.h>
+#include <log4cxx/logger.h>
+#include <log4cxx/patternlayout.h>
+
+#include "logger/log4cxx/appender_snapshot.h"
+
+namespace visionary_logger {
+
+namespace {
+
+char const magic[8] = {'V', 'L', 'O', 'G', 'C', 'F', 'G', 2};
+
+std::string read_file(std::string const& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error(
+		    "Logger configuration file '" + filename + "' could not be read");
+	}
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+std::string trim(std::string const& value)
+{
+	size_t const begin = value.find_first_not_of(" \t\r\f");
+	if (begin == std::string::npos) {
+		return std::string();
+	}
+	return value.substr(begin, value.find_last_not_of(" \t\r\f") - begin + 1);
+}
+
+std::string lower(std::string value)
+{
+	std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) {
+		return static_cast<char>(std::tolower(c));
+	});
+	return value;
+}
+
+bool starts_with(std::string const& value, char const* prefix)
+{
+	return value.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+/// resolve the escapes of java properties, e.g. "\\:" and "\\t"
+std::string unescape(std::string const& value)
+{
+	std::string ret;
+	for (size_t i = 0; i < value.size(); ++i) {
+		char c = value[i];
+		if (c == '\\' && i + 1 < value.size()) {
+			c = value[++i];
+			if (c == 'u') {
+				throw std::runtime_error("unsupported unicode escape in '" + value + "'");
+			}
+			c = (c == 't') ? '\t' : (c == 'n') ? '\n' : (c == 'r') ? '\r' : c;
+		}
+		ret += c;
+	}
+	return ret;
+}
+
+/// key-value pairs of a java properties file, in file order
+std::vector<std::pair<std::string, std::string>> parse_properties(std::string const& text)
+{
+	std::vector<std::pair<std::string, std::string>> ret;
+	size_t pos = 0;
+	while (pos < text.size()) {
+		// join continuation lines ending in an odd number of backslashes
+		std::string line;
+		bool continued = true;
+		for (bool first = true; continued && pos < text.size(); first = false) {
+			size_t end = text.find('\n', pos);
+			if (end == std::string::npos) {
+				end = text.size();
+			}
+			std::string part = text.substr(pos, end - pos);
+			pos = end + 1;
+			if (!part.empty() && part.back() == '\r') {
+				part.pop_back();
+			}
+			if (!first) {
+				part = trim(part);
+			}
+			size_t const last = part.find_last_not_of('\\');
+			size_t const backslashes = part.size() - ((last == std::string::npos) ? 0 : last + 1);
+			continued = (backslashes % 2 == 1);
+			if (continued) {
+				part.pop_back();
+			}
+			line += part;
+		}
+
+		line = trim(line);
+		if (line.empty() || line[0] == '#' || line[0] == '!') {
+			continue;
+		}
+
+		// the key ends at the first unescaped separator or whitespace
+		size_t key_end = 0;
+		while (key_end < line.size() && !std::strchr("=: \t\f", line[key_end])) {
+			key_end += (line[key_end] == '\\') ? 2 : 1;
+		}
+		key_end = std::min(key_end, line.size());
+		size_t value_begin = line.find_first_not_of(" \t\f", key_end);
+		if (value_begin != std::string::npos &&
+		    (line[value_begin] == '=' || line[value_begin] == ':')) {
+			value_begin = line.find_first_not_of(" \t\f", value_begin + 1);
+		}
+		std::string const key = unescape(line.substr(0, key_end));
+		std::string const value =
+		    (value_begin == std::string::npos) ? std::string() : line.substr(value_begin);
+		if (value.find("${") != std::string::npos) {
+			throw std::runtime_error("unsupported variable substitution in '" + key + "'");
+		}
+		ret.emplace_back(key, unescape(value));
+	}
+	return ret;
+}
+
+/// class name without the package prefixes accepted by log4cxx
+std::string class_name(std::string const& value)
+{
+	for (char const* prefix : {"org.apache.log4j.", "org.apache.log4cxx.", "log4cxx."}) {
+		if (starts_with(value, prefix)) {
+			return value.substr(std::strlen(prefix));
+		}
+	}
+	return value;
+}
+
+bool to_bool(std::string const& key, std::string const& value)
+{
+	std::string const v = lower(value);
+	if (v != "true" && v != "false") {
+		throw std::runtime_error("invalid boolean '" + value + "' for '" + key + "'");
+	}
+	return v == "true";
+}
+
+int32_t to_level(std::string const& key, std::string const& value)
+{
+	log4cxx::LevelPtr const level = log4cxx::Level::toLevel(value, log4cxx::LevelPtr());
+	if (!level) {
+		throw std::runtime_error("unsupported level '" + value + "' for '" + key + "'");
+	}
+	return level->toInt();
+}
+
+/// little endian on every host, compiled files may be shared by heterogeneous nodes
+void put_u32(std::string& out, uint32_t value)
+{
+	for (int shift = 0; shift < 32; shift += 8) {
+		out += static_cast<char>((value >> shift) & 0xff);
+	}
+}
+
+void put_i32(std::string& out, int32_t value)
+{
+	put_u32(out, static_cast<uint32_t>(value));
+}
+
+void put_string(std::string& out, std::string const& value)
+{
+	put_u32(out, static_cast<uint32_t>(value.size()));
+	out += value;
+}
+
+class Reader
+{
+public:
+	explicit Reader(std::string const& data) : m_pos(data.data()), m_end(data.data() + data.size())
+	{}
+
+	uint8_t get_u8()
+	{
+		uint8_t value;
+		take(&value, sizeof(value));
+		return value;
+	}
+
+	int8_t get_i8()
+	{
+		return static_cast<int8_t>(get_u8());
+	}
+
+	bool get_bool()
+	{
+		return get_u8() != 0;
+	}
+
+	uint32_t get_u32()
+	{
+		unsigned char bytes[4];
+		take(bytes, sizeof(bytes));
+		return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) |
+		       (uint32_t(bytes[3]) << 24);
+	}
+
+	int32_t get_i32()
+	{
+		return static_cast<int32_t>(get_u32());
+	}
+
+	std::string get_string()
+	{
+		std::string value(get_u32(), '\0');
+		take(&value[0], value.size());
+		return value;
+	}
+
+	void skip(size_t size)
+	{
+		take(nullptr, size);
+	}
+
+private:
+	void take(void* destination, size_t size)
+	{
+		if (static_cast<size_t>(m_end - m_pos) < size) {
+			throw std::runtime_error("truncated compiled logger configuration");
+		}
+		if (destination) {
+			std::memcpy(destination, m_pos, size);
+		}
+		m_pos += size;
+	}
+
+	char const* m_pos;
+	char const* m_end;
+};
+
+} // namespace
+
+CompiledConfig CompiledConfig::parse(std::string const& filename)
+{
+	CompiledConfig ret;
+	std::map<std::string, size_t> loggers;
+	std::map<std::string, size_t> appenders;
+	auto logger = [&](std::string const& name) -> Logger& {
+		auto const it = loggers.emplace(name, ret.loggers.size());
+		if (it.second) {
+			ret.loggers.push_back(Logger{name, keep, 0, keep, false, {}});
+		}
+		return ret.loggers[it.first->second];
+	};
+	auto appender = [&](std::string const& name) -> Appender& {
+		auto const it = appenders.emplace(name, ret.appenders.size());
+		if (it.second) {
+			ret.appenders.push_back(Appender{name, true, "System.out", true, true, 0, 0, "%m%n"});
+		}
+		return ret.appenders[it.first->second];
+	};
+
+	std::vector<std::string> classes;
+	for (auto const& property : parse_properties(read_file(filename))) {
+		std::string const& key = property.first;
+		std::string const& value = property.second;
+
+		if (key == "log4j.rootLogger" || key == "log4j.rootCategory" ||
+		    starts_with(key, "log4j.logger.") || starts_with(key, "log4j.category.")) {
+			std::string const name =
+			    starts_with(key, "log4j.root") ? std::string() : key.substr(key.find('.', 6) + 1);
+			Logger& l = logger(name);
+			// "LEVEL, A1, A2", the level may be omitted
+			size_t pos = value.find(',');
+			std::string const level = trim(value.substr(0, pos));
+			if (!level.empty()) {
+				std::string const lowered = lower(level);
+				if (lowered == "inherited" || lowered == "null") {
+					l.has_level = name.empty() ? keep : 0;
+				} else {
+					l.has_level = 1;
+					l.level = to_level(key, level);
+				}
+			}
+			// as PropertyConfigurator, the line replaces all appenders of the logger
+			l.has_appenders = true;
+			l.appenders.clear();
+			while (pos != std::string::npos) {
+				size_t const next = value.find(',', pos + 1);
+				std::string const appender_name = trim(value.substr(pos + 1, next - pos - 1));
+				if (!appender_name.empty()) {
+					l.appenders.push_back(appender_name);
+				}
+				pos = next;
+			}
+		} else if (starts_with(key, "log4j.additivity.")) {
+			logger(key.substr(std::strlen("log4j.additivity."))).additive = to_bool(key, value);
+		} else if (starts_with(key, "log4j.appender.")) {
+			std::string const rest = key.substr(std::strlen("log4j.appender."));
+			size_t const dot = rest.find('.');
+			Appender& a = appender(rest.substr(0, dot));
+			std::string const option =
+			    (dot == std::string::npos) ? std::string() : lower(rest.substr(dot + 1));
+			if (option.empty()) {
+				std::string const type = class_name(value);
+				if (type != "ConsoleAppender" && type != "FileAppender") {
+					throw std::runtime_error("unsupported appender class '" + value + "'");
+				}
+				a.console = (type == "ConsoleAppender");
+				classes.push_back(a.name);
+			} else if (option == "target" || option == "file") {
+				a.target = value;
+			} else if (option == "append") {
+				a.append = to_bool(key, value);
+			} else if (option == "immediateflush") {
+				a.immediate_flush = to_bool(key, value);
+			} else if (option == "threshold") {
+				a.has_threshold = 1;
+				a.threshold = to_level(key, value);
+			} else if (option == "layout") {
+				if (class_name(value) != "PatternLayout") {
+					throw std::runtime_error("unsupported layout class '" + value + "'");
+				}
+			} else if (option == "layout.conversionpattern") {
+				a.pattern = value;
+			} else {
+				throw std::runtime_error("unsupported appender option '" + key + "'");
+			}
+		} else {
+			throw std::runtime_error("unsupported property '" + key + "'");
+		}
+	}
+
+	for (Logger const& l : ret.loggers) {
+		for (std::string const& name : l.appenders) {
+			if (std::find(classes.begin(), classes.end(), name) == classes.end()) {
+				throw std::runtime_error("appender '" + name + "' has no class");
+			}
+		}
+	}
+	return ret;
+}
+
+CompiledConfig CompiledConfig::load(std::string const& filename)
+{
+	std::string const data = read_file(filename);
+	if (data.compare(0, sizeof(magic), magic, sizeof(magic)) != 0) {
+		throw std::runtime_error("'" + filename + "' is not a compiled logger configuration");
+	}
+	Reader reader(data);
+	reader.skip(sizeof(magic));
+
+	CompiledConfig ret;
+	ret.appenders.resize(reader.get_u32());
+	for (Appender& a : ret.appenders) {
+		a.name = reader.get_string();
+		a.console = reader.get_bool();
+		a.target = reader.get_string();
+		a.append = reader.get_bool();
+		a.immediate_flush = reader.get_bool();
+		a.has_threshold = reader.get_i8();
+		a.threshold = reader.get_i32();
+		a.pattern = reader.get_string();
+	}
+	ret.loggers.resize(reader.get_u32());
+	for (Logger& l : ret.loggers) {
+		l.name = reader.get_string();
+		l.has_level = reader.get_i8();
+		l.level = reader.get_i32();
+		l.additive = reader.get_i8();
+		l.has_appenders = reader.get_bool();
+		l.appenders.resize(reader.get_u32());
+		for (std::string& name : l.appenders) {
+			name = reader.get_string();
+		}
+	}
+	return ret;
+}
+
+bool CompiledConfig::is_compiled(std::string const& filename)
+{
+	char header[sizeof(magic)] = {};
+	std::ifstream file(filename, std::ios::binary);
+	file.read(header, sizeof(header));
+	return file && std::memcmp(header, magic, sizeof(magic)) == 0;
+}
+
+void CompiledConfig::save(std::string const& filename) const
+{
+	std::string out(magic, sizeof(magic));
+	put_u32(out, static_cast<uint32_t>(appenders.size()));
+	for (Appender const& a : appenders) {
+		put_string(out, a.name);
+		out += static_cast<char>(a.console);
+		put_string(out, a.target);
+		out += static_cast<char>(a.append);
+		out += static_cast<char>(a.immediate_flush);
+		out += static_cast<char>(a.has_threshold);
+		put_i32(out, a.threshold);
+		put_string(out, a.pattern);
+	}
+	put_u32(out, static_cast<uint32_t>(loggers.size()));
+	for (Logger const& l : loggers) {
+		put_string(out, l.name);
+		out += static_cast<char>(l.has_level);
+		put_i32(out, l.level);
+		out += static_cast<char>(l.additive);
+		out += static_cast<char>(l.has_appenders);
+		put_u32(out, static_cast<uint32_t>(l.appenders.size()));
+		for (std::string const& name : l.appenders) {
+			put_string(out, name);
+		}
+	}
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(out.data(), static_cast<std::streamsize>(out.size()));
+	if (!file.flush()) {
+		throw std::runtime_error("Could not write '" + filename + "'");
+	}
+}
+
+void CompiledConfig::apply(log4cxx::spi::LoggerRepositoryPtr repository) const
+{
+	// appenders are only created if referenced, as by PropertyConfigurator
+	std::map<std::string, log4cxx::AppenderPtr> created;
+	auto create = [this, &created](std::string const& name) -> log4cxx::AppenderPtr {
+		log4cxx::AppenderPtr& ret = created[name];
+		if (ret) {
+			return ret;
+		}
+		auto const a = std::find_if(appenders.begin(), appenders.end(), [&name](Appender const& a) {
+			return a.name == name;
+		});
+		if (a == appenders.end()) {
+			throw std::runtime_error("appender '" + name + "' has no class");
+		}
+		log4cxx::LayoutPtr layout(new log4cxx::PatternLayout(a->pattern));
+		if (a->console) {
+			log4cxx::ConsoleAppenderPtr appender(new log4cxx::ConsoleAppender(layout, a->target));
+			appender->setImmediateFlush(a->immediate_flush);
+			ret = appender;
+		} else {
+			log4cxx::FileAppenderPtr appender(
+			    new log4cxx::FileAppender(layout, a->target, a->append));
+			appender->setImmediateFlush(a->immediate_flush);
+			ret = appender;
+		}
+		ret->setName(a->name);
+		if (a->has_threshold == 1) {
+			dynamic_pointer_cast<log4cxx::AppenderSkeleton>(ret)->setThreshold(
+			    log4cxx::Level::toLevel(a->threshold));
+		}
+		return ret;
+	};
+
+	for (Logger const& l : loggers) {
+		log4cxx::LoggerPtr const logger =
+		    l.name.empty() ? repository->getRootLogger() : repository->getLogger(l.name);
+		if (l.has_level == 1) {
+			logger->setLevel(log4cxx::Level::toLevel(l.level));
+		} else if (l.has_level == 0) {
+			logger->setLevel(log4cxx::LevelPtr());
+		}
+		if (l.additive != keep) {
+			logger->setAdditivity(l.additive == 1);
+		}
+		if (!l.has_appenders) {
+			// only named by e.g. log4j.additivity.X, keeps its appenders
+			continue;
+		}
+		logger->removeAllAppenders();
+		for (std::string const& name : l.appenders) {
+			logger->addAppender(create(name));
+		}
+	}
+	// neither additivity nor removeAllAppenders are reported by log4cxx
+	appenders_changed();
+}
+
+} // namespace visionary_logger
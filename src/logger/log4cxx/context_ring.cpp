@@ -0,0 +1,199 @@
+#include "logger/log4cxx/context_ring.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include <log4cxx/spi/loggingevent.h>
+
+#include "logger/fixed_stream.h"
+
+namespace visionary_logger {
+
+namespace detail {
+
+namespace {
+
+std::mutex config_mutex;
+size_t config_events = 0;
+size_t config_message_size = 256;
+/// bumped on every (re-)configuration, rings are reallocated lazily by their threads
+std::atomic<uint64_t> config_generation{0};
+
+int64_t now_us()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+	           std::chrono::system_clock::now().time_since_epoch())
+	    .count();
+}
+
+} // namespace
+
+class ContextRing
+{
+public:
+	ContextRing(size_t events, size_t message_size, uint64_t generation) :
+	    m_generation(generation),
+	    m_message_size(message_size),
+	    m_slots(new Slot[events]),
+	    m_capacity(events),
+	    m_storage(new char[events * message_size]),
+	    m_total(0),
+	    m_dumping(false),
+	    m_stream(&m_buffer)
+	{
+		for (size_t i = 0; i < m_capacity; ++i) {
+			m_slots[i].message = m_storage.get() + i * m_message_size;
+			m_slots[i].length = 0;
+		}
+	}
+
+	/**
+	 * Ring of the calling thread for the current configuration, nullptr if disabled.
+	 */
+	static ContextRing* local()
+	{
+		thread_local std::unique_ptr<ContextRing> ring;
+		uint64_t const generation = config_generation.load(std::memory_order_acquire);
+		if (!ring || ring->m_generation != generation) {
+			std::lock_guard<std::mutex> lock(config_mutex);
+			if (config_events == 0) {
+				ring.reset();
+			} else {
+				ring.reset(new ContextRing(config_events, config_message_size, generation));
+			}
+		}
+		return ring.get();
+	}
+
+	void begin(log4cxx::Logger* logger, int level, log4cxx::spi::LocationInfo const& location)
+	{
+		Slot& slot = m_slots[m_total % m_capacity];
+		slot.timestamp = now_us();
+		slot.level = level;
+		slot.logger = logger;
+		slot.location = location;
+		m_buffer.reset(slot.message, slot.message + m_message_size);
+		// like a fresh stream for every statement
+		logger::detail::reset_stream(m_stream);
+	}
+
+	std::ostream& stream()
+	{
+		return m_stream;
+	}
+
+	void commit()
+	{
+		m_slots[m_total % m_capacity].length = m_buffer.size();
+		++m_total;
+	}
+
+	void dump()
+	{
+		if (m_dumping) {
+			// an appender logged an error
+			return;
+		}
+		m_dumping = true;
+
+		int64_t const now = now_us();
+		log4cxx::helpers::Pool pool;
+		size_t const size = std::min(m_total, m_capacity);
+		for (size_t i = m_total - size; i < m_total; ++i) {
+			Slot const& slot = m_slots[i % m_capacity];
+			char age[64];
+			snprintf(
+			    age, sizeof(age), "[context %.3f ms ago] ",
+			    static_cast<double>(now - slot.timestamp) / 1000.);
+			std::string message(age);
+			message.append(slot.message, slot.length);
+
+			log4cxx::spi::LoggingEventPtr event(new log4cxx::spi::LoggingEvent(
+			    slot.logger->getName(), log4cxx::Level::toLevel(slot.level), message,
+			    slot.location));
+			slot.logger->callAppenders(event, pool);
+		}
+		m_total = 0;
+		m_dumping = false;
+	}
+
+private:
+	struct Slot
+	{
+		int64_t timestamp;
+		int level;
+		/// loggers are owned by the repository and never destroyed
+		log4cxx::Logger* logger;
+		log4cxx::spi::LocationInfo location;
+		char* message;
+		size_t length;
+	};
+
+	uint64_t const m_generation;
+	size_t const m_message_size;
+	std::unique_ptr<Slot[]> m_slots;
+	size_t const m_capacity;
+	std::unique_ptr<char[]> m_storage;
+	size_t m_total;
+	bool m_dumping;
+
+	logger::detail::FixedStreamBuffer m_buffer;
+	std::ostream m_stream;
+};
+
+} // namespace detail
+
+void enable_context_ring(size_t events, size_t message_size)
+{
+	std::lock_guard<std::mutex> lock(detail::config_mutex);
+	detail::config_events = events;
+	detail::config_message_size = message_size;
+	detail::config_generation.fetch_add(1, std::memory_order_release);
+	detail::context_ring_enabled.store(events > 0, std::memory_order_relaxed);
+}
+
+void disable_context_ring()
+{
+	enable_context_ring(0);
+}
+
+void dump_context_ring()
+{
+	detail::ContextRing* ring = detail::ContextRing::local();
+	if (ring) {
+		ring->dump();
+	}
+}
+
+ContextRecord::ContextRecord(
+    log4cxx::LoggerPtr const& logger,
+    log4cxx::LevelPtr const& level,
+    log4cxx::spi::LocationInfo const& location) :
+    m_ring(detail::ContextRing::local())
+{
+	if (m_ring) {
+		m_ring->begin(logger.get(), level->toInt(), location);
+	}
+}
+
+ContextRecord::~ContextRecord()
+{
+	if (m_ring) {
+		m_ring->commit();
+	}
+}
+
+std::ostream& ContextRecord::stream()
+{
+	if (m_ring) {
+		return m_ring->stream();
+	}
+	// disabled concurrently
+	thread_local std::ostream null_stream(nullptr);
+	return null_stream;
+}
+
+} // namespace visionary_logger
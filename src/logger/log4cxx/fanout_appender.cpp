@@ -0,0 +1,329 @@
+#include "logger/log4cxx/fanout_appender.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <log4cxx/helpers/loglog.h>
+#include <log4cxx/spi/loggingevent.h>
+
+#include "logger/log4cxx/logger.h"
+
+namespace log4cxx {
+
+namespace {
+
+char const* const months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                              "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+iovec piece(char const* data, size_t size)
+{
+	return iovec{const_cast<char*>(data), size};
+}
+
+iovec piece(std::string const& data)
+{
+	return piece(data.data(), data.size());
+}
+
+/// @return false on errors other than interruptions, errno is set
+bool write_all(int fd, iovec* pieces, int count)
+{
+	while (count != 0) {
+		ssize_t written = writev(fd, pieces, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		// skip what was written, usually everything
+		while (count != 0 && static_cast<size_t>(written) >= pieces->iov_len) {
+			written -= static_cast<ssize_t>(pieces->iov_len);
+			++pieces;
+			--count;
+		}
+		if (count != 0) {
+			pieces->iov_base = static_cast<char*>(pieces->iov_base) + written;
+			pieces->iov_len -= static_cast<size_t>(written);
+		}
+	}
+	return true;
+}
+
+/// date decoration of the sinks, " " followed by the date, empty for none
+void format_date(
+    char (&buffer)[32], FanOutAppender::DateFormat format, struct tm const& time, int millisecond)
+{
+	switch (format) {
+		case FanOutAppender::DateFormat::none:
+			buffer[0] = '\0';
+			break;
+		case FanOutAppender::DateFormat::absolute:
+			snprintf(
+			    buffer, sizeof(buffer), " %02d:%02d:%02d,%03d", time.tm_hour, time.tm_min,
+			    time.tm_sec, millisecond);
+			break;
+		case FanOutAppender::DateFormat::date:
+			snprintf(
+			    buffer, sizeof(buffer), " %02d %s %04d %02d:%02d:%02d,%03d", time.tm_mday,
+			    months[time.tm_mon], time.tm_year + 1900, time.tm_hour, time.tm_min, time.tm_sec,
+			    millisecond);
+			break;
+		case FanOutAppender::DateFormat::iso8601:
+			snprintf(
+			    buffer, sizeof(buffer), " %04d-%02d-%02d %02d:%02d:%02d,%03d",
+			    time.tm_year + 1900, time.tm_mon + 1, time.tm_mday, time.tm_hour, time.tm_min,
+			    time.tm_sec, millisecond);
+			break;
+	}
+}
+
+/// custom levels are padded like %-5p and never colored
+void custom_level_tags(LevelPtr const& level, FanOutAppender::LevelTags& tags)
+{
+	level->toString(tags.plain);
+	tags.plain.resize(std::max<size_t>(tags.plain.size(), 5), ' ');
+	tags.colored = tags.plain;
+}
+
+/// buffered console streams are flushed after events at or above this level
+int const console_flush_level = Level::ERROR_INT;
+
+} // namespace
+
+bool FanOutAppender::parse_date_format(std::string const& name, DateFormat& format)
+{
+	if (name == "ABSOLUTE") {
+		format = DateFormat::absolute;
+	} else if (name == "DATE") {
+		format = DateFormat::date;
+	} else if (name == "ISO8601") {
+		format = DateFormat::iso8601;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+FanOutAppender::LevelTags const* FanOutAppender::predefined_level_tags(LevelPtr const& level)
+{
+	static LevelTags const tags[] = {
+	    {"TRACE", "\x1B[34mTRACE\x1B[0m"}, {"DEBUG", "\x1B[36mDEBUG\x1B[0m"},
+	    {"INFO ", "\x1B[32mINFO \x1B[0m"}, {"WARN ", "\x1B[33mWARN \x1B[0m"},
+	    {"ERROR", "\x1B[31mERROR\x1B[0m"}, {"FATAL", "\x1B[35mFATAL\x1B[0m"}};
+	switch (level->toInt()) {
+		case Level::TRACE_INT:
+			return &tags[0];
+		case Level::DEBUG_INT:
+			return &tags[1];
+		case Level::INFO_INT:
+			return &tags[2];
+		case Level::WARN_INT:
+			return &tags[3];
+		case Level::ERROR_INT:
+			return &tags[4];
+		case Level::FATAL_INT:
+			return &tags[5];
+		default:
+			return nullptr;
+	}
+}
+
+FanOutAppender::FanOutAppender() : m_second(-1), m_time(), m_millisecond(0), m_date_valid()
+{
+	setName("FANOUT");
+}
+
+FanOutAppender::~FanOutAppender()
+{
+	close();
+}
+
+void FanOutAppender::close()
+{
+	// events being appended complete first, later ones see closed
+	std::lock_guard<decltype(mutex)> lock(mutex);
+	if (closed) {
+		return;
+	}
+	closed = true;
+	for (Sink const& sink : m_sinks) {
+		if (sink.kind == Kind::console) {
+			fflush(sink.stream);
+		} else if (sink.kind == Kind::file) {
+			::close(sink.fd);
+		}
+	}
+	m_sinks.clear();
+}
+
+void FanOutAppender::add_console(
+    bool color, DateFormat date, bool location, FILE* stream, bool buffered)
+{
+	m_sinks.push_back(Sink{Kind::console, color, date, location, stream, -1, buffered});
+}
+
+void FanOutAppender::add_file(
+    std::string const& filename, bool append, DateFormat date, bool location)
+{
+	int const fd = ::open(
+	    filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (append ? 0 : O_TRUNC),
+	    0644);
+	if (fd < 0) {
+		throw std::runtime_error(
+		    "Could not open log file '" + filename + "': " + std::strerror(errno));
+	}
+	m_sinks.push_back(Sink{Kind::file, false, date, location, nullptr, fd, false});
+}
+
+void FanOutAppender::add_syslog()
+{
+	m_sinks.push_back(Sink{Kind::syslog, false, DateFormat::absolute, true, nullptr, -1, false});
+}
+
+std::string const& FanOutAppender::date(DateFormat format)
+{
+	size_t const index = static_cast<size_t>(format);
+	if (m_date_valid[index]) {
+		return m_dates[index];
+	}
+	char buffer[32];
+	format_date(buffer, format, m_time, m_millisecond);
+	m_dates[index] = buffer;
+	m_date_valid[index] = true;
+	return m_dates[index];
+}
+
+void FanOutAppender::append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool&)
+{
+	// parts shared by all sinks
+	log4cxx_time_t const timestamp = event->getTimeStamp();
+	time_t const second = static_cast<time_t>(timestamp / 1000000);
+	if (second != m_second) {
+		localtime_r(&second, &m_time);
+		m_second = second;
+	}
+	m_millisecond = static_cast<int>((timestamp / 1000) % 1000);
+	std::fill(std::begin(m_date_valid), std::end(m_date_valid), false);
+
+	LevelPtr const& level = event->getLevel();
+	LevelTags const* tags = predefined_level_tags(level);
+	if (!tags) {
+		custom_level_tags(level, m_custom_tags);
+		tags = &m_custom_tags;
+	}
+	m_body.assign("  ");
+	m_body += event->getLoggerName();
+	m_body += ' ';
+	m_body += event->getRenderedMessage();
+	m_body += '\n';
+	spi::LocationInfo const& location = event->getLocationInformation();
+	m_location.clear();
+
+	for (Sink const& sink : m_sinks) {
+		if (sink.location && m_location.empty()) {
+			m_location = std::string("  ->  ") + location.getFileName() + ":" +
+			             std::to_string(location.getLineNumber()) + "\n";
+		}
+
+		size_t const count = sink.location ? 4 : 3;
+		switch (sink.kind) {
+			case Kind::console: {
+				// one piece, unbuffered streams like stderr write it with a single call
+				m_console.assign(sink.color ? tags->colored : tags->plain);
+				m_console += date(sink.date);
+				m_console += m_body;
+				if (sink.location) {
+					m_console += m_location;
+				}
+				flockfile(sink.stream);
+				fwrite_unlocked(m_console.data(), 1, m_console.size(), sink.stream);
+				if (!sink.buffered || level->toInt() >= console_flush_level) {
+					fflush_unlocked(sink.stream);
+				}
+				funlockfile(sink.stream);
+				break;
+			}
+			case Kind::file: {
+				iovec pieces[] = {
+				    piece(tags->plain), piece(date(sink.date)), piece(m_body), piece(m_location)};
+				if (!write_all(sink.fd, pieces, static_cast<int>(count))) {
+					helpers::LogLog::error(
+					    LogString(LOG4CXX_STR("FanOutAppender: ")) + std::strerror(errno));
+				}
+				break;
+			}
+			case Kind::syslog: {
+				// only errors of the ERROR and FATAL macros, as their own mirror
+				if (visionary_logger::detail::syslog_mirror !=
+				        visionary_logger::detail::SyslogMirror::requested ||
+				    level->toInt() < Level::ERROR_INT) {
+					break;
+				}
+				// as make_syslog_layout(), without the backtrace appended by the macros
+				static std::string const backtrace_header =
+				    std::string(visionary_logger::backtrace_prefix) + "Printing stack backtrace\n";
+				size_t const backtrace = m_body.find(backtrace_header);
+				m_syslog.assign(tags->plain);
+				m_syslog += date(DateFormat::absolute);
+				if (backtrace == std::string::npos) {
+					m_syslog += m_body;
+				} else {
+					m_syslog.append(m_body, 0, backtrace);
+					m_syslog += '\n';
+				}
+				m_syslog += m_location;
+				visionary_logger::write_to_syslog(m_syslog);
+				visionary_logger::detail::syslog_mirror =
+				    visionary_logger::detail::SyslogMirror::written;
+				break;
+			}
+		}
+	}
+}
+
+ConsoleLayout::ConsoleLayout(bool color) : m_color(color) {}
+
+void ConsoleLayout::format(
+    LogString& output, const spi::LoggingEventPtr& event, log4cxx::helpers::Pool&) const
+{
+	LevelPtr const& level = event->getLevel();
+	FanOutAppender::LevelTags const* tags = FanOutAppender::predefined_level_tags(level);
+	FanOutAppender::LevelTags custom_tags;
+	if (!tags) {
+		custom_level_tags(level, custom_tags);
+		tags = &custom_tags;
+	}
+
+	log4cxx_time_t const timestamp = event->getTimeStamp();
+	time_t const second = static_cast<time_t>(timestamp / 1000000);
+	struct tm time;
+	localtime_r(&second, &time);
+	char date[32];
+	format_date(
+	    date, FanOutAppender::DateFormat::absolute, time,
+	    static_cast<int>((timestamp / 1000) % 1000));
+
+	output.append(m_color ? tags->colored : tags->plain);
+	output.append(date);
+	output.append("  ");
+	output.append(event->getLoggerName());
+	output.append(1, ' ');
+	output.append(event->getRenderedMessage());
+	output.append(1, '\n');
+}
+
+bool ConsoleLayout::ignoresThrowable() const
+{
+	return true;
+}
+
+} // namespace log4cxx
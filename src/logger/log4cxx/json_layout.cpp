@@ -0,0 +1,132 @@
+#include "logger/log4cxx/json_layout.h"
+
+#include <string_view>
+
+#include <log4cxx/spi/loggingevent.h>
+
+#include "logger/fields.h"
+#include "logger/log4cxx/logger.h"
+
+namespace log4cxx {
+
+namespace {
+
+char const* level_name(const LevelPtr& level)
+{
+	switch (level->toInt()) {
+		case Level::TRACE_INT:
+			return "TRACE";
+		case Level::DEBUG_INT:
+			return "DEBUG";
+		case Level::INFO_INT:
+			return "INFO";
+		case Level::WARN_INT:
+			return "WARN";
+		case Level::ERROR_INT:
+			return "ERROR";
+		case Level::FATAL_INT:
+			return "FATAL";
+		default:
+			return nullptr;
+	}
+}
+
+void append_string_member(LogString& output, char const* name, std::string_view value)
+{
+	output += ",\"";
+	output += name;
+	output += "\":\"";
+	logger::detail::append_json_string(output, value);
+	output += '"';
+}
+
+/**
+ * Append the backtrace lines of print_backtrace() as array, without the prefix and the header
+ * line.
+ */
+void append_backtrace(LogString& output, std::string_view backtrace)
+{
+	std::string_view const prefix(visionary_logger::backtrace_prefix);
+	output += ",\"backtrace\":[";
+	bool first = true;
+	bool header = true;
+	while (!backtrace.empty()) {
+		size_t const end = backtrace.find('\n');
+		std::string_view line = backtrace.substr(0, end);
+		backtrace.remove_prefix((end == std::string_view::npos) ? backtrace.size() : end + 1);
+		if (line.substr(0, prefix.size()) == prefix) {
+			line.remove_prefix(prefix.size());
+		}
+		if (header) {
+			header = false;
+			continue;
+		}
+		if (!first) {
+			output += ',';
+		}
+		first = false;
+		output += '"';
+		logger::detail::append_json_string(output, line);
+		output += '"';
+	}
+	output += ']';
+}
+
+} // namespace
+
+void JSONLinesLayout::format(
+    LogString& output, const spi::LoggingEventPtr& event, log4cxx::helpers::Pool&) const
+{
+	char number[32];
+	std::to_chars_result res;
+
+	// log4cxx timestamps are microseconds since epoch
+	output += "{\"time_ns\":";
+	res = std::to_chars(
+	    number, number + sizeof(number), static_cast<int64_t>(event->getTimeStamp()) * 1000);
+	output.append(number, res.ptr);
+
+	char const* level = level_name(event->getLevel());
+	append_string_member(output, "level", level ? level : event->getLevel()->toString());
+	append_string_member(output, "logger", event->getLoggerName());
+	append_string_member(output, "thread", event->getThreadName());
+
+	spi::LocationInfo const& location = event->getLocationInformation();
+	if (location.getLineNumber() >= 0) {
+		append_string_member(output, "file", location.getFileName());
+		output += ",\"line\":";
+		res = std::to_chars(number, number + sizeof(number), location.getLineNumber());
+		output.append(number, res.ptr);
+	}
+
+	// ERROR and FATAL macros append the backtrace to the message
+	static std::string const backtrace_header =
+	    std::string(visionary_logger::backtrace_prefix) + "Printing stack backtrace\n";
+	std::string_view message(event->getRenderedMessage());
+	size_t const backtrace = message.find(backtrace_header);
+	append_string_member(output, "message", message.substr(0, backtrace));
+	if (backtrace != std::string_view::npos) {
+		append_backtrace(output, message.substr(backtrace));
+	}
+
+	// appenders run in the logging thread, so these are the fields of this event
+	logger::append_json_members(output, visionary_logger::current_fields());
+	output += logger::StaticFields::instance().get().json_members;
+	output += "}\n";
+}
+
+LogString JSONLinesLayout::getContentType() const
+{
+	return "application/json";
+}
+
+bool JSONLinesLayout::ignoresThrowable() const
+{
+	return true;
+}
+
+void JSONLinesLayout::activateOptions(log4cxx::helpers::Pool&) {}
+
+void JSONLinesLayout::setOption(const LogString&, const LogString&) {}
+
+} // namespace log4cxx
@@ -1,6 +1,8 @@
 /* log4cxx-based logger needs cxx lib, nothing else */
 
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 
 extern "C" {
 #include <execinfo.h>
@@ -8,41 +10,126 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include "logger/fields.h"
+#include "logger/log4cxx/appender_snapshot.h"
+#include "logger/log4cxx/logger.h"
 #include "logger/log4cxx/logging_ctrl.h"
+#include "logger/syslog/logger.h"
+#include <log4cxx/helpers/loglog.h>
+#include <log4cxx/mdc.h>
 #include <log4cxx/patternlayout.h>
 
 namespace visionary_logger {
 
 std::string print_backtrace() {
 	std::stringstream ret;
-	ret << "print_trace: Printing stack backtrace\n";
+	ret << backtrace_prefix << "Printing stack backtrace\n";
 
 	void* array[10];
 	size_t size = backtrace(array, 10);
 	char** strings = backtrace_symbols(array, size);
 
 	for (size_t i = 0; i < size; i++)
-		ret << "print_trace: " << strings[i] << "\n";
+		ret << backtrace_prefix << strings[i] << "\n";
 
 	return ret.str();
 }
 
 std::string make_syslog_prefix() {
-	std::stringstream ret;
-	ret << "vislog"
-	    << " uid=" << getuid()
-		<< " pid=" << getpid();
+	// uid, pid, hostname and SLURM_JOBID unless changed
+	return "vislog " + logger::StaticFields::instance().get().text + "|";
+}
+
+thread_local detail::SyslogMirror detail::syslog_mirror = detail::SyslogMirror::none;
+
+namespace {
 
-	char hostname[_POSIX_HOST_NAME_MAX + 1];
-	if (gethostname(hostname, sizeof hostname) == 0 ) {
-		ret << " hostname=" << hostname;
+thread_local logger::Fields current_event_fields;
+
+/// static fields put into the calling thread's MDC
+thread_local logger::StaticFields::Snapshot const* installed_static_fields = nullptr;
+
+void install_static_fields()
+{
+	logger::StaticFields::Snapshot const& snapshot = logger::StaticFields::instance().get();
+	if (installed_static_fields == &snapshot) {
+		return;
 	}
-	char * slurm_job_id = getenv("SLURM_JOBID");
-	if (slurm_job_id != nullptr ) {
-		ret << " SLURM_JOBID=" << slurm_job_id;
+	if (installed_static_fields) {
+		for (logger::Field const& field : installed_static_fields->fields) {
+			log4cxx::MDC::remove(std::string(field.key));
+		}
 	}
-	ret << "|";
-	return ret.str();
+	for (logger::Field const& field : snapshot.fields) {
+		log4cxx::MDC::put(std::string(field.key), logger::to_string(field.value));
+	}
+	installed_static_fields = &snapshot;
+}
+
+/// Puts the fields of one event into the calling thread's MDC, restoring shadowed entries
+/// afterwards.
+class ScopedEventFields
+{
+public:
+	ScopedEventFields(logger::Fields fields) :
+	    m_fields(fields), m_previous_fields(current_event_fields)
+	{
+		m_shadowed.resize(fields.size());
+		size_t i = 0;
+		for (logger::Field const& field : fields) {
+			std::string key(field.key);
+			m_shadowed[i].present = log4cxx::MDC::get(key, m_shadowed[i].value);
+			log4cxx::MDC::put(key, logger::to_string(field.value));
+			++i;
+		}
+		current_event_fields = fields;
+	}
+
+	~ScopedEventFields()
+	{
+		current_event_fields = m_previous_fields;
+		size_t i = 0;
+		for (logger::Field const& field : m_fields) {
+			std::string key(field.key);
+			if (m_shadowed[i].present) {
+				log4cxx::MDC::put(key, m_shadowed[i].value);
+			} else {
+				log4cxx::MDC::remove(key);
+			}
+			++i;
+		}
+	}
+
+private:
+	/// MDC entry replaced by a field, empty values are valid entries
+	struct Shadowed
+	{
+		bool present = false;
+		std::string value;
+	};
+
+	logger::Fields m_fields;
+	logger::Fields m_previous_fields;
+	std::vector<Shadowed> m_shadowed;
+};
+
+} // namespace
+
+void forced_log_with_fields(
+    log4cxx::LoggerPtr const& logger,
+    log4cxx::LevelPtr const& level,
+    std::string const& message,
+    log4cxx::spi::LocationInfo const& location,
+    logger::Fields fields)
+{
+	install_static_fields();
+	ScopedEventFields scoped(fields);
+	logger->forcedLog(level, message, location);
+}
+
+logger::Fields current_fields()
+{
+	return current_event_fields;
 }
 
 static log4cxx::LayoutPtr make_syslog_layout()
@@ -56,7 +143,14 @@ static log4cxx::LayoutPtr make_syslog_layout()
 
 void write_to_syslog(std::string message) {
 	static const std::string prefix = make_syslog_prefix();
-	syslog(LOG_ERR, (prefix + message).c_str());
+	std::string const record = prefix + message;
+	// the asynchronous sender keeps slow syslog daemons off the logging thread
+	if (logger::syslog_async_enabled()) {
+		logger::detail::SyslogClient::instance().send(
+		    logger::LogPriority::ERROR, record.data(), record.size());
+	} else {
+		syslog(LOG_ERR, "%s", record.c_str());
+	}
 }
 
 void write_to_syslog(
@@ -69,6 +163,13 @@ void write_to_syslog(
 	using namespace log4cxx::helpers;
 	using namespace log4cxx::spi;
 
+	// already written by a FanOutAppender while appending the event
+	bool const written = (detail::syslog_mirror == detail::SyslogMirror::written);
+	detail::syslog_mirror = detail::SyslogMirror::none;
+	if (written) {
+		return;
+	}
+
 	static const LayoutPtr layout = make_syslog_layout();
 
 	Pool p;
@@ -82,7 +183,7 @@ void write_to_syslog(
 } // namespace visionary_logger
 
 void configure_default_logger(log4cxx::LoggerPtr logger,
-		log4cxx::LevelPtr level, std::string fname, bool dual)
+		log4cxx::LevelPtr level, std::string fname, bool dual, bool json)
 {
 	if (fname.empty() && dual)
 		throw std::logic_error("dual log mode requires a filename");
@@ -90,7 +191,7 @@ void configure_default_logger(log4cxx::LoggerPtr logger,
 	logger->setLevel(level);
 
 	static bool already_added_cout = false;
-	if (logger->getAllAppenders().size() == 0) {
+	if (!visionary_logger::has_appenders(logger)) {
 		already_added_cout = false;
 	}
 	if ((fname.empty() || dual) && !already_added_cout) {
@@ -101,7 +202,7 @@ void configure_default_logger(log4cxx::LoggerPtr logger,
 
 	if (!fname.empty())
 	{
-		log4cxx::AppenderPtr app = logger_write_to_file(fname, true, logger);
+		log4cxx::AppenderPtr app = logger_write_to_file(fname, true, logger, json);
 		app->setName("FILE");
 	}
 }
@@ -109,9 +210,26 @@ void configure_default_logger(log4cxx::LoggerPtr logger,
 log4cxx::LoggerPtr get_default_logger(std::string logger_name, log4cxx::LevelPtr level, std::string fname, bool dual)
 {
 	log4cxx::LoggerPtr new_logger = log4cxx::Logger::getLogger(logger_name);
-	if (log4cxx::Logger::getRootLogger()->getAllAppenders().size() == 0
-			&& new_logger->getAllAppenders().size() == 0)
+	if (!visionary_logger::has_appenders(log4cxx::Logger::getRootLogger())
+			&& !visionary_logger::has_appenders(new_logger))
 	{
+		// deterministic setup of batch jobs, also when first called during static initialization;
+		// applied once, it is not parsed again for every message if it configures neither logger
+		static std::once_flag from_environment;
+		std::call_once(from_environment, [] {
+			if (!logger_config_from_environment() || logger_config_path().empty()) {
+				return;
+			}
+			try {
+				logger_config_from_file(logger_config_path());
+			} catch (std::exception const& e) {
+				log4cxx::helpers::LogLog::error(e.what());
+			}
+		});
+		if (visionary_logger::has_appenders(log4cxx::Logger::getRootLogger())
+				|| visionary_logger::has_appenders(new_logger)) {
+			return new_logger;
+		}
 		// TODO Don't spam the root logger ?
 		// new_logger->setAdditivity(false);
 		configure_default_logger(new_logger, level, fname, dual);
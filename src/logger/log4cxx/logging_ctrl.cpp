@@ -1,7 +1,12 @@
 #include "logger/log4cxx/logging_ctrl.h"
 
+#include <cstdlib>
+#include <cstring>
 #include <stdexcept>
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <log4cxx/basicconfigurator.h>
 #include <log4cxx/consoleappender.h>
 #include <log4cxx/fileappender.h>
@@ -10,11 +15,19 @@
 
 #include <boost/filesystem.hpp>
 
+#include "logger/log4cxx/appender_snapshot.h"
+#include "logger/log4cxx/async_file_appender.h"
+#include "logger/log4cxx/compiled_config.h"
+#include "logger/log4cxx/fanout_appender.h"
+#include "logger/log4cxx/json_layout.h"
 #include "logger/log4cxx/logger.h"
+#include "logger/log4cxx/reloadable_appender.h"
+#include "logger/log4cxx/shm_appender.h"
 
 void logger_reset()
 {
 	log4cxx::BasicConfigurator::resetConfiguration();
+	visionary_logger::appenders_changed();
 }
 
 void logger_config_from_file(std::string filename)
@@ -27,7 +40,84 @@ void logger_config_from_file(std::string filename)
 		err << "Logger configuration file '" << p.native() << "' could not be found";
 		throw std::runtime_error(err.str());
 	}
-	log4cxx::PropertyConfigurator::configure(p.c_str());
+	if (visionary_logger::CompiledConfig::is_compiled(p.native())) {
+		visionary_logger::CompiledConfig::load(p.native()).apply();
+	} else {
+		log4cxx::PropertyConfigurator::configure(p.c_str());
+	}
+	// removed appenders are not reported by log4cxx
+	visionary_logger::appenders_changed();
+}
+
+void logger_compile_config(std::string const& filename, std::string const& output)
+{
+	visionary_logger::CompiledConfig::parse(filename).save(output);
+}
+
+namespace {
+
+struct ConfigLookup
+{
+	ConfigLookup() : from_environment(false)
+	{
+		if (char const* env = std::getenv("SYMAP2IC_LOGGER_CONF")) {
+			from_environment = true;
+			path = env;
+		} else {
+			struct stat st;
+			if (stat("symap2ic_logger.conf", &st) == 0) {
+				path = "symap2ic_logger.conf";
+			}
+		}
+		if (!path.empty()) {
+			// later changes of the working directory do not matter
+			path = boost::filesystem::system_complete(path).native();
+		}
+	}
+
+	std::string path;
+	bool from_environment;
+};
+
+ConfigLookup const& config_lookup()
+{
+	static ConfigLookup const lookup;
+	return lookup;
+}
+
+log4cxx::LayoutPtr make_file_layout(bool json)
+{
+	if (json) {
+		return log4cxx::LayoutPtr(new log4cxx::JSONLinesLayout);
+	}
+	return log4cxx::LayoutPtr(new log4cxx::PatternLayout("%-5p %d{ISO8601}  %c %m\n"));
+}
+
+} // namespace
+
+std::string const& logger_config_path()
+{
+	return config_lookup().path;
+}
+
+bool logger_config_from_environment()
+{
+	return config_lookup().from_environment;
+}
+
+log4cxx::AppenderPtr logger_watch_config(std::string const& filename)
+{
+	log4cxx::LoggerPtr root = log4cxx::Logger::getRootLogger();
+	// copied, the snapshot is replaced by adding the appender
+	log4cxx::AppenderList const previous = visionary_logger::appender_chain(root)->appenders;
+	log4cxx::AppenderPtr appender(new log4cxx::ReloadableAppender(filename));
+	root->addAppender(appender);
+	// not closed here, events being appended complete and the last reference closes them
+	for (log4cxx::AppenderPtr const& old : previous) {
+		root->removeAppender(old);
+	}
+	visionary_logger::appenders_changed();
+	return appender;
 }
 
 log4cxx::AppenderPtr
@@ -36,21 +126,57 @@ logger_append_to_file(std::string const& filename, log4cxx::LoggerPtr logger)
 	return logger_write_to_file(filename, true, logger);
 }
 
-log4cxx::AppenderPtr
-logger_write_to_file(std::string const& filename, bool append, log4cxx::LoggerPtr logger)
+log4cxx::AppenderPtr logger_write_to_file(
+    std::string const& filename, bool append, log4cxx::LoggerPtr logger, bool json)
 {
-	log4cxx::LayoutPtr layout(new log4cxx::PatternLayout("%-5p %d{ISO8601}  %c %m\n"));
 	log4cxx::FileAppenderPtr appender(new log4cxx::FileAppender(
-				layout, filename, append));
+				make_file_layout(json), filename, append));
 	appender->setImmediateFlush(true);
 	logger->addAppender(appender);
 	return appender;
 }
 
+log4cxx::AppenderPtr logger_write_to_file_async(
+    std::string const& filename, bool append, log4cxx::LoggerPtr logger, bool json)
+{
+	log4cxx::AppenderPtr appender(
+	    new log4cxx::AsyncFileAppender(make_file_layout(json), filename, append));
+	logger->addAppender(appender);
+	return appender;
+}
+
+log4cxx::AppenderPtr logger_write_to_shm(
+    std::string const& name, log4cxx::LoggerPtr logger, bool json)
+{
+	log4cxx::LayoutPtr layout;
+	if (json) {
+		layout.reset(new log4cxx::JSONLinesLayout);
+	} else {
+		// the collector merges several processes
+		layout.reset(new log4cxx::PatternLayout(
+		    "%-5p %d{ISO8601}  [" + std::to_string(getpid()) + "] %c %m\n"));
+	}
+	log4cxx::AppenderPtr appender(new log4cxx::SharedMemoryAppender(
+	    layout, name.empty() ? logger::shm_default_name() : name));
+	logger->addAppender(appender);
+	return appender;
+}
+
+
+bool logger_console_colors()
+{
+#ifdef CONFIG_NO_COLOR
+	return false;
+#else
+	// batch jobs write to files, the escape codes would only clutter them
+	static bool const terminal = isatty(STDOUT_FILENO);
+	return terminal;
+#endif
+}
 
 log4cxx::AppenderPtr logger_write_to_cout(log4cxx::LoggerPtr logger)
 {
-	log4cxx::LayoutPtr layout(new log4cxx::PatternLayout("%Y%-5p%y %d{HH:mm:ss,SSS}  %c %m\n"));
+	log4cxx::LayoutPtr layout(new log4cxx::ConsoleLayout(logger_console_colors()));
 	log4cxx::AppenderPtr appender(new log4cxx::ConsoleAppender(layout));
 	logger->addAppender(appender);
 	return appender;
@@ -75,33 +201,73 @@ log4cxx::AppenderPtr logger_log_to_cout(log4cxx::LevelPtr level)
 
 void logger_default_config(
 		log4cxx::LevelPtr level, std::string fname, bool dual,
-		bool print_location, bool use_color, std::string date_format)
+		bool print_location, bool use_color, std::string date_format, bool json, bool watch,
+		bool fanout)
 {
-	using namespace boost::filesystem;
-
-	path logger_config("symap2ic_logger.conf");
-	if (exists(logger_config))
+	std::string const& logger_config = logger_config_path();
+	use_color = use_color && logger_console_colors();
+	log4cxx::FanOutAppender::DateFormat date;
+	if (!logger_config.empty())
+	{
+		if (watch) {
+			logger_watch_config(logger_config);
+		} else {
+			logger_config_from_file(logger_config);
+		}
+	}
+	else if (fanout && !json && log4cxx::FanOutAppender::parse_date_format(date_format, date))
 	{
-		logger_config_from_file(system_complete(logger_config).native());
+		if (fname.empty() && dual)
+			throw std::logic_error("dual log mode requires a filename");
+
+		// console, file and syslog mirror formatted in one pass
+		log4cxx::LoggerPtr root = log4cxx::Logger::getRootLogger();
+		root->setLevel(level);
+		log4cxx::FanOutAppenderPtr fanout(new log4cxx::FanOutAppender);
+		if (fname.empty() || dual) {
+			fanout->add_console(use_color, date, print_location);
+		}
+		if (!fname.empty()) {
+			fanout->add_file(fname, true, date, print_location);
+		}
+		fanout->add_syslog();
+		// repeated calls replace the previous configuration, also the one of the RELATIVE/NULL
+		// path and of configure_default_logger
+		for (char const* name : {"FANOUT", "COUT", "FILE"}) {
+			root->removeAppender(name);
+		}
+		visionary_logger::appenders_changed();
+		root->addAppender(fanout);
 	}
 	else
 	{
 		configure_default_logger(log4cxx::Logger::getRootLogger(),
-				level, fname, dual);
+				level, fname, dual, json);
+
+		std::string const pattern = "%-5p %d{" + date_format + "}  %c %m\n" +
+		                            (print_location ? std::string("  ->  %F:%L\n") : std::string());
+		std::string const color_pattern =
+		    "%Y%-5p%y" + pattern.substr(std::strlen("%-5p"));
 
 		log4cxx::helpers::Pool pool;
-		log4cxx::AppenderList list =
-			log4cxx::Logger::getRootLogger()->getAllAppenders();
-		for (log4cxx::AppenderList::iterator it = list.begin(), end = list.end();
-				it != end; ++it)
+		visionary_logger::AppenderChainPtr const chain =
+			visionary_logger::appender_chain(log4cxx::Logger::getRootLogger());
+		for (log4cxx::AppenderList::const_iterator it = chain->appenders.begin(),
+				end = chain->appenders.end(); it != end; ++it)
 		{
 			bool const local_use_color = ((*it)->getName() != "FILE") ? use_color : false;
 			log4cxx::PatternLayoutPtr layout =
 			    dynamic_pointer_cast<log4cxx::PatternLayout>((*it)->getLayout());
-			layout->setConversionPattern(
-			    (local_use_color ? std::string("%Y") : std::string()) + "%-5p" +
-			    (local_use_color ? std::string("%y") : std::string()) + " %d{" + date_format +
-			    "}  %c %m\n" + (print_location ? std::string("  ->  %F:%L\n") : std::string()));
+			if (!layout && dynamic_pointer_cast<log4cxx::ConsoleLayout>((*it)->getLayout())) {
+				// date formats and locations beyond those of logger_write_to_cout
+				layout.reset(new log4cxx::PatternLayout);
+				(*it)->setLayout(layout);
+			}
+			if (!layout) {
+				// e.g. JSON lines, not affected by the pattern options
+				continue;
+			}
+			layout->setConversionPattern(local_use_color ? color_pattern : pattern);
 			layout->activateOptions(pool);
 		}
 	}
@@ -0,0 +1,301 @@
+#include "logger/log4cxx/reloadable_appender.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <log4cxx/helpers/loglog.h>
+#include <log4cxx/hierarchy.h>
+#include <log4cxx/logger.h>
+#include <log4cxx/propertyconfigurator.h>
+#include <log4cxx/spi/loggingevent.h>
+
+#include <boost/filesystem.hpp>
+
+#include "logger/log4cxx/compiled_config.h"
+
+namespace log4cxx {
+
+struct ReloadableAppender::Configuration
+{
+	struct Node
+	{
+		bool additive;
+		AppenderList appenders;
+	};
+
+	~Configuration()
+	{
+		// retired, no event uses the appenders anymore
+		repository->shutdown();
+	}
+
+	/// owns the appenders
+	spi::LoggerRepositoryPtr repository;
+	AppenderList root;
+	/// loggers with own appenders or without additivity, by name
+	std::unordered_map<LogString, Node> loggers;
+	LevelPtr root_level;
+	/// levels of all loggers named in the file, nullptr for inherited levels
+	std::vector<std::pair<LogString, LevelPtr>> levels;
+};
+
+/// configure a separate hierarchy, the live one is not touched
+std::shared_ptr<ReloadableAppender::Configuration const>
+ReloadableAppender::load(std::string const& filename)
+{
+	if (!boost::filesystem::exists(filename)) {
+		throw std::runtime_error(
+		    "Logger configuration file '" + filename + "' could not be found");
+	}
+
+	auto configuration = std::make_shared<Configuration>();
+	HierarchyPtr hierarchy = Hierarchy::create();
+	configuration->repository = hierarchy;
+	if (visionary_logger::CompiledConfig::is_compiled(filename)) {
+		visionary_logger::CompiledConfig::load(filename).apply(hierarchy);
+	} else {
+		PropertyConfigurator().doConfigure(File(filename), hierarchy);
+	}
+
+	LoggerPtr const root = hierarchy->getRootLogger();
+	configuration->root = root->getAllAppenders();
+	configuration->root_level = root->getLevel();
+	bool has_appenders = !configuration->root.empty();
+	for (LoggerPtr const& logger : hierarchy->getCurrentLoggers()) {
+		configuration->levels.emplace_back(logger->getName(), logger->getLevel());
+		AppenderList appenders = logger->getAllAppenders();
+		has_appenders = has_appenders || !appenders.empty();
+		if (!appenders.empty() || !logger->getAdditivity()) {
+			configuration->loggers.emplace(
+			    logger->getName(), Configuration::Node{logger->getAdditivity(), std::move(appenders)});
+		}
+	}
+	if (!has_appenders) {
+		// e.g. caught while an editor rewrites the file, would silence all logging
+		throw std::runtime_error(
+		    "Logger configuration file '" + filename + "' defines no appenders");
+	}
+	return configuration;
+}
+
+/// mirror the levels of the file in the live hierarchy, levels only set by the previous
+/// configuration are reset to be inherited
+void ReloadableAppender::apply_levels(
+    Configuration const& configuration, Configuration const* previous)
+{
+	std::unordered_set<LogString> named;
+	for (auto const& level : configuration.levels) {
+		Logger::getLogger(level.first)->setLevel(level.second);
+		named.insert(level.first);
+	}
+	if (previous) {
+		for (auto const& level : previous->levels) {
+			if (named.count(level.first) == 0) {
+				Logger::getLogger(level.first)->setLevel(LevelPtr());
+			}
+		}
+	}
+	if (configuration.root_level) {
+		Logger::getRootLogger()->setLevel(configuration.root_level);
+	}
+}
+
+ReloadableAppender::ReloadableAppender(std::string const& filename, bool watch) :
+    m_filename(boost::filesystem::system_complete(filename).string()),
+    m_generation(0),
+    m_inotify(-1),
+    m_stop(-1)
+{
+	setName("RELOAD");
+	if (watch) {
+		// watch the directory, editors and deployment scripts replace the file by renaming
+		std::string const directory =
+		    boost::filesystem::path(m_filename).parent_path().string();
+		m_inotify = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+		m_stop = eventfd(0, EFD_CLOEXEC);
+		if (m_inotify < 0 || m_stop < 0 ||
+		    inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			std::string const error = std::strerror(errno);
+			close();
+			throw std::runtime_error("Cannot watch '" + directory + "': " + error);
+		}
+	}
+	try {
+		reload();
+	} catch (...) {
+		close();
+		throw;
+	}
+	if (watch) {
+		m_watcher = std::thread(&ReloadableAppender::watch, this);
+	}
+}
+
+ReloadableAppender::~ReloadableAppender()
+{
+	close();
+}
+
+void ReloadableAppender::close()
+{
+	if (m_watcher.joinable()) {
+		uint64_t const one = 1;
+		if (::write(m_stop, &one, sizeof(one)) == sizeof(one)) {
+			m_watcher.join();
+		} else {
+			m_watcher.detach();
+		}
+	}
+	if (m_inotify >= 0) {
+		::close(m_inotify);
+		m_inotify = -1;
+	}
+	if (m_stop >= 0) {
+		::close(m_stop);
+		m_stop = -1;
+	}
+
+	std::lock_guard<std::mutex> lock(m_reload_mutex);
+	publish(nullptr);
+	closed = true;
+}
+
+void ReloadableAppender::doAppend(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool)
+{
+	// as AppenderSkeleton::doAppend without the lock; once closed, append() finds no configuration
+	if (!isAsSevereAsThreshold(event->getLevel())) {
+		return;
+	}
+	for (spi::FilterPtr filter = getFirstFilter(); filter; filter = filter->getNext()) {
+		spi::Filter::FilterDecision const decision = filter->decide(event);
+		if (decision == spi::Filter::DENY) {
+			return;
+		}
+		if (decision == spi::Filter::ACCEPT) {
+			break;
+		}
+	}
+	append(event, pool);
+}
+
+void ReloadableAppender::append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool)
+{
+	// holds the configuration until the event is appended
+	std::shared_ptr<Configuration const> const configuration = std::atomic_load(&m_configuration);
+	if (!configuration) {
+		return;
+	}
+
+	if (!configuration->loggers.empty()) {
+		// walk up the logger names as Logger::callAppenders does, "a.b.c", "a.b", "a"
+		thread_local LogString prefix;
+		LogString const& name = event->getLoggerName();
+		size_t end = name.size();
+		while (true) {
+			prefix.assign(name, 0, end);
+			auto const it = configuration->loggers.find(prefix);
+			if (it != configuration->loggers.end()) {
+				for (AppenderPtr const& appender : it->second.appenders) {
+					appender->doAppend(event, pool);
+				}
+				if (!it->second.additive) {
+					return;
+				}
+			}
+			size_t const dot = (end > 0) ? name.rfind('.', end - 1) : LogString::npos;
+			if (dot == LogString::npos) {
+				break;
+			}
+			end = dot;
+		}
+	}
+	for (AppenderPtr const& appender : configuration->root) {
+		appender->doAppend(event, pool);
+	}
+}
+
+void ReloadableAppender::reload()
+{
+	std::lock_guard<std::mutex> lock(m_reload_mutex);
+	std::shared_ptr<Configuration const> configuration = load(m_filename);
+	{
+		std::shared_ptr<Configuration const> const previous = std::atomic_load(&m_configuration);
+		apply_levels(*configuration, previous.get());
+	}
+	publish(std::move(configuration));
+}
+
+uint64_t ReloadableAppender::generation() const
+{
+	return m_generation.load(std::memory_order_relaxed);
+}
+
+void ReloadableAppender::publish(std::shared_ptr<Configuration const> configuration)
+{
+	bool const published = static_cast<bool>(configuration);
+	std::shared_ptr<Configuration const> previous =
+	    std::atomic_exchange(&m_configuration, std::move(configuration));
+	if (published) {
+		m_generation.fetch_add(1, std::memory_order_relaxed);
+	}
+	// grace period: every event that loaded the previous configuration holds a reference, events
+	// starting now load the new one
+	while (previous && previous.use_count() > 1) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	// closes the previous appenders in this thread
+}
+
+void ReloadableAppender::watch()
+{
+	std::string const basename = boost::filesystem::path(m_filename).filename().string();
+	pollfd fds[2] = {{m_inotify, POLLIN, 0}, {m_stop, POLLIN, 0}};
+	alignas(inotify_event) char buffer[4096];
+
+	while (true) {
+		if (poll(fds, 2, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			helpers::LogLog::error(
+			    LOG4CXX_STR("ReloadableAppender: stopped watching ") + m_filename);
+			return;
+		}
+		if (fds[1].revents) {
+			return;
+		}
+
+		bool changed = false;
+		ssize_t length;
+		while ((length = ::read(m_inotify, buffer, sizeof(buffer))) > 0) {
+			for (char const* p = buffer; p < buffer + length;) {
+				inotify_event const* event = reinterpret_cast<inotify_event const*>(p);
+				if (event->len > 0 && basename == event->name) {
+					changed = true;
+				}
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+		if (!changed) {
+			continue;
+		}
+		try {
+			reload();
+		} catch (std::exception const& error) {
+			// keep logging with the current configuration
+			helpers::LogLog::error(LogString(LOG4CXX_STR("ReloadableAppender: ")) + error.what());
+		}
+	}
+}
+
+} // namespace log4cxx
@@ -0,0 +1,39 @@
+#include "logger/log4cxx/shm_appender.h"
+
+#include <log4cxx/layout.h>
+#include <log4cxx/spi/loggingevent.h>
+
+namespace log4cxx {
+
+SharedMemoryAppender::SharedMemoryAppender(
+    LayoutPtr const& layout, std::string const& name, size_t capacity, size_t record_size) :
+    m_queue(new logger::ShmQueue(name, capacity, record_size))
+{
+	setLayout(layout);
+	m_buffer.reserve(m_queue->record_size());
+}
+
+SharedMemoryAppender::~SharedMemoryAppender()
+{
+	close();
+}
+
+void SharedMemoryAppender::close()
+{
+	closed = true;
+}
+
+uint64_t SharedMemoryAppender::dropped() const
+{
+	return m_queue->dropped();
+}
+
+void SharedMemoryAppender::append(const spi::LoggingEventPtr& event, log4cxx::helpers::Pool& pool)
+{
+	m_buffer.clear();
+	layout->format(m_buffer, event, pool);
+	// a full queue counts the record as dropped
+	m_queue->try_push(m_buffer.data(), m_buffer.size());
+}
+
+} // namespace log4cxx
@@ -0,0 +1,168 @@
+#include "logger/log4cxx/timing.h"
+
+#include <cstdio>
+#include <thread>
+#include <unordered_map>
+
+namespace visionary_logger {
+
+namespace {
+
+struct Calibration
+{
+	uint64_t ticks;
+	std::chrono::steady_clock::time_point time;
+};
+
+Calibration const& calibration_start()
+{
+	static Calibration const start{timer_ticks(), std::chrono::steady_clock::now()};
+	return start;
+}
+
+std::atomic<uint64_t> next_timer_id{0};
+
+/// histograms of the calling thread by timer id, ids are never reused
+thread_local std::unordered_map<uint64_t, std::shared_ptr<LatencyHistogram>> local_histograms;
+
+void append_duration(std::string& output, double ns)
+{
+	char buffer[32];
+	if (ns < 1e3) {
+		snprintf(buffer, sizeof(buffer), "%.0fns", ns);
+	} else if (ns < 1e6) {
+		snprintf(buffer, sizeof(buffer), "%.3gus", ns / 1e3);
+	} else if (ns < 1e9) {
+		snprintf(buffer, sizeof(buffer), "%.3gms", ns / 1e6);
+	} else {
+		snprintf(buffer, sizeof(buffer), "%.3gs", ns / 1e9);
+	}
+	output += buffer;
+}
+
+} // namespace
+
+double ticks_per_ns()
+{
+	Calibration const& start = calibration_start();
+	auto elapsed = std::chrono::steady_clock::now() - start.time;
+	// too short for a meaningful rate
+	while (elapsed < std::chrono::milliseconds(1)) {
+		std::this_thread::yield();
+		elapsed = std::chrono::steady_clock::now() - start.time;
+	}
+	uint64_t const ticks = timer_ticks() - start.ticks;
+	auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+	return static_cast<double>(ticks) / static_cast<double>(ns);
+}
+
+LatencyTimer::LatencyTimer(
+    log4cxx::LoggerPtr logger,
+    std::string name,
+    std::chrono::milliseconds period,
+    log4cxx::LevelPtr level) :
+    m_logger(std::move(logger)),
+    m_name(std::move(name)),
+    m_level(std::move(level)),
+    m_id(next_timer_id.fetch_add(1, std::memory_order_relaxed)),
+    m_period_ticks(
+        static_cast<uint64_t>(static_cast<double>(period.count()) * 1e6 * ticks_per_ns())),
+    m_next_report(timer_ticks() + m_period_ticks),
+    m_reported(LatencyHistogram::buckets, 0)
+{}
+
+LatencyTimer::~LatencyTimer() {}
+
+LatencyHistogram& LatencyTimer::local()
+{
+	// most threads only use the timers of one loop
+	thread_local uint64_t last_id = UINT64_MAX;
+	thread_local LatencyHistogram* last = nullptr;
+	if (last_id == m_id) {
+		return *last;
+	}
+
+	std::shared_ptr<LatencyHistogram>& histogram = local_histograms[m_id];
+	if (!histogram) {
+		histogram = std::make_shared<LatencyHistogram>();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_histograms.push_back(histogram);
+	}
+	last_id = m_id;
+	last = histogram.get();
+	return *last;
+}
+
+void LatencyTimer::report_if_due()
+{
+	uint64_t const now = timer_ticks();
+	uint64_t due = m_next_report.load(std::memory_order_relaxed);
+	if (due > now) {
+		return;
+	}
+	// only one thread logs the summary of this period
+	if (m_next_report.compare_exchange_strong(
+	        due, now + m_period_ticks, std::memory_order_relaxed)) {
+		report();
+	}
+}
+
+LatencyTimer::Summary LatencyTimer::summary()
+{
+	std::vector<uint64_t> counts(LatencyHistogram::buckets, 0);
+	Summary ret{0, 0., 0., 0.};
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto const& histogram : m_histograms) {
+			for (size_t i = 0; i < counts.size(); ++i) {
+				counts[i] += histogram->count(i);
+			}
+		}
+		for (size_t i = 0; i < counts.size(); ++i) {
+			uint64_t const total = counts[i];
+			counts[i] -= m_reported[i];
+			m_reported[i] = total;
+			ret.count += counts[i];
+		}
+	}
+	if (ret.count == 0) {
+		return ret;
+	}
+
+	double const scale = 1. / ticks_per_ns();
+	uint64_t const p50 = (ret.count + 1) / 2;
+	uint64_t const p99 = ret.count - ret.count / 100;
+	uint64_t seen = 0;
+	for (size_t i = 0; i < counts.size(); ++i) {
+		if (counts[i] == 0) {
+			continue;
+		}
+		double const value = static_cast<double>(LatencyHistogram::upper_bound(i)) * scale;
+		if (seen < p50 && seen + counts[i] >= p50) {
+			ret.p50_ns = value;
+		}
+		if (seen < p99 && seen + counts[i] >= p99) {
+			ret.p99_ns = value;
+		}
+		ret.max_ns = value;
+		seen += counts[i];
+	}
+	return ret;
+}
+
+void LatencyTimer::report()
+{
+	Summary const s = summary();
+	if (s.count == 0 || !m_logger->isEnabledFor(m_level)) {
+		return;
+	}
+	std::string message = "timer " + m_name + ": n=" + std::to_string(s.count) + " p50=";
+	append_duration(message, s.p50_ns);
+	message += " p99=";
+	append_duration(message, s.p99_ns);
+	message += " max=";
+	append_duration(message, s.max_ns);
+	m_logger->forcedLog(m_level, message, LOG4CXX_LOCATION);
+}
+
+} // namespace visionary_logger
@@ -1,7 +1,28 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <regex>
+#include <thread>
+
+#include <unistd.h>
+
+#include <log4cxx/mdc.h>
+#include <log4cxx/patternlayout.h>
+#include <log4cxx/spi/loggingevent.h>
+
+#include "logger/log4cxx/appender_snapshot.h"
+#include "logger/log4cxx/async_file_appender.h"
+#include "logger/log4cxx/capture_appender.h"
+#include "logger/log4cxx/compiled_config.h"
+#include "logger/log4cxx/fanout_appender.h"
 #include "logger/log4cxx/logger.h"
+#include "logger/log4cxx/reloadable_appender.h"
+#include "logger/log4cxx/shm_appender.h"
+#include "logger/log4cxx/timing.h"
 
 class LoggerTest : public ::testing::Test
 {
@@ -29,3 +50,638 @@ TEST_F(LoggerTest, TestThrowActive)
 	ASSERT_NO_THROW(LOG4CXX_DEBUG(logger, "DEBUG_MSG"));
 	ASSERT_NO_THROW(LOG4CXX_TRACE(logger, "TRACE_MSG"));
 }
+
+TEST_F(LoggerTest, TestFields)
+{
+	char fname[] = "/tmp/test_logger_fields_XXXXXX";
+	::close(mkstemp(fname));
+
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.fields");
+	log4cxx::LayoutPtr layout(new log4cxx::PatternLayout("%X{run} %X{chip} %X{pid} %m%n"));
+	logger->addAppender(log4cxx::AppenderPtr(new log4cxx::FileAppender(layout, fname, false)));
+
+	LOG4CXX_LOG_FIELDS(
+	    logger, log4cxx::Level::getWarn(), logger::fields("run", 3, "chip", "w62"), "with fields");
+	LOG4CXX_WARN(logger, "without fields");
+	logger->removeAllAppenders();
+
+	std::ifstream file(fname);
+	std::string line;
+	std::getline(file, line);
+	EXPECT_EQ("3 w62 " + std::to_string(getpid()) + " with fields", line);
+	// static fields stay in the thread's MDC, per-event fields are removed
+	std::getline(file, line);
+	EXPECT_EQ("  " + std::to_string(getpid()) + " without fields", line);
+	EXPECT_TRUE(visionary_logger::current_fields().empty());
+	std::remove(fname);
+
+	// shadowed entries are restored, also empty ones
+	log4cxx::MDC::put("run", "");
+	LOG4CXX_LOG_FIELDS(logger, log4cxx::Level::getWarn(), logger::fields("run", 4), "shadowing");
+	std::string run = "unset";
+	EXPECT_TRUE(log4cxx::MDC::get("run", run));
+	EXPECT_EQ("", run);
+	log4cxx::MDC::remove("run");
+}
+
+TEST_F(LoggerTest, TestJSONLines)
+{
+	char fname[] = "/tmp/test_logger_json_XXXXXX";
+	::close(mkstemp(fname));
+
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.json");
+	logger->setLevel(log4cxx::Level::getInfo());
+	logger_write_to_file(fname, false, logger, true);
+
+	LOG4CXX_INFO(logger, "multi\nline \"quoted\"");
+	LOG4CXX_ERROR(logger, "with backtrace");
+	LOG4CXX_LOG_FIELDS(logger, log4cxx::Level::getWarn(), logger::fields("run", 3), "fields");
+	logger->removeAllAppenders();
+
+	std::ifstream file(fname);
+	std::string line;
+	std::getline(file, line);
+	EXPECT_EQ(0u, line.find("{\"time_ns\":")) << line;
+	EXPECT_NE(std::string::npos, line.find(R"(,"level":"INFO","logger":"loggertests.json")"));
+	EXPECT_NE(std::string::npos, line.find(R"(,"message":"multi\nline \"quoted\"")"));
+	EXPECT_NE(std::string::npos, line.find(",\"pid\":" + std::to_string(getpid())));
+	EXPECT_EQ('}', line.back());
+
+	// the backtrace is split off the message
+	std::getline(file, line);
+	EXPECT_NE(std::string::npos, line.find(R"(,"message":"with backtrace","backtrace":[")"))
+	    << line;
+	EXPECT_EQ(std::string::npos, line.find("print_trace")) << line;
+
+	std::getline(file, line);
+	EXPECT_NE(std::string::npos, line.find(R"(,"message":"fields","run":3,)")) << line;
+	EXPECT_FALSE(std::getline(file, line));
+	std::remove(fname);
+}
+
+TEST_F(LoggerTest, TestCapture)
+{
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.capture");
+	logger->setLevel(log4cxx::Level::getDebug());
+	log4cxx::CaptureAppenderPtr capture(
+	    new log4cxx::CaptureAppender(3, log4cxx::Level::getInfo(), 9));
+	logger->addAppender(capture);
+
+	LOG4CXX_DEBUG(logger, "below threshold");
+	for (int i = 0; i < 4; ++i) {
+		LOG4CXX_INFO(logger, "message " << i);
+	}
+	LOG4CXX_WARN(logger, "truncated message");
+	logger->removeAppender(capture);
+
+	// oldest events are overwritten
+	std::vector<log4cxx::CapturedEvent> const events = capture->events();
+	ASSERT_EQ(3u, events.size());
+	EXPECT_EQ(5u, capture->total());
+	EXPECT_EQ("message 2", events[0].message);
+	EXPECT_EQ("message 3", capture->messages()[1]);
+	EXPECT_EQ("truncated", events[2].message);
+	EXPECT_TRUE(events[2].level->equals(log4cxx::Level::getWarn()));
+	EXPECT_EQ("loggertests.capture", events[2].logger);
+	EXPECT_LE(events[0].timestamp, events[2].timestamp);
+
+	// UTF-8 characters are not split, 9 bytes would end inside the second "ä"
+	logger->addAppender(capture);
+	LOG4CXX_INFO(logger, "messag\xc3\xa4\xc3\xa4");
+	logger->removeAppender(capture);
+	EXPECT_EQ("messag\xc3\xa4", capture->messages()[2]);
+
+	capture->clear();
+	EXPECT_EQ(0u, capture->size());
+}
+
+TEST_F(LoggerTest, TestContextRing)
+{
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.context");
+	logger->setLevel(log4cxx::Level::getWarn());
+	log4cxx::CaptureAppenderPtr capture(new log4cxx::CaptureAppender(10));
+	logger->addAppender(capture);
+
+	LOG4CXX_DEBUG(logger, "not recorded");
+	visionary_logger::enable_context_ring(2, 16);
+	for (int i = 0; i < 3; ++i) {
+		LOG4CXX_DEBUG(logger, "context " << std::hex << i);
+	}
+	// manipulators of one statement do not leak into the next
+	LOG4CXX_DEBUG(logger, "context " << 10);
+	LOG4CXX_INFO(logger, "truncated context message");
+	EXPECT_EQ(0u, capture->size());
+
+	LOG4CXX_ERROR(logger, "error");
+	// ring is cleared by the dump
+	LOG4CXX_ERROR(logger, "error");
+	visionary_logger::disable_context_ring();
+	LOG4CXX_DEBUG(logger, "not recorded");
+	LOG4CXX_ERROR(logger, "error");
+	logger->removeAppender(capture);
+
+	std::vector<log4cxx::CapturedEvent> const events = capture->events();
+	ASSERT_EQ(5u, events.size());
+	EXPECT_TRUE(events[0].level->equals(log4cxx::Level::getDebug()));
+	EXPECT_NE(std::string::npos, events[0].message.find(" ms ago] context 10"));
+	EXPECT_TRUE(events[1].level->equals(log4cxx::Level::getInfo()));
+	EXPECT_NE(std::string::npos, events[1].message.find(" ms ago] truncated contex"));
+	EXPECT_EQ(std::string::npos, events[1].message.find("message"));
+	for (size_t i = 2; i < events.size(); ++i) {
+		EXPECT_TRUE(events[i].level->equals(log4cxx::Level::getError()));
+		EXPECT_EQ(0u, events[i].message.find("error"));
+	}
+}
+
+TEST_F(LoggerTest, TestSharedMemory)
+{
+	std::string const name = "/vislog-test-" + std::to_string(getpid());
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.shm");
+	logger->setLevel(log4cxx::Level::getInfo());
+	log4cxx::SharedMemoryAppenderPtr appender(new log4cxx::SharedMemoryAppender(
+	    log4cxx::LayoutPtr(new log4cxx::PatternLayout("%-5p %c %m\n")), name, 2, 64));
+	logger->addAppender(appender);
+
+	// the collector side attaches to the segment created by the appender
+	logger::ShmQueue queue(name);
+	EXPECT_EQ(2u, queue.capacity());
+
+	LOG4CXX_INFO(logger, "first");
+	LOG4CXX_WARN(logger, "second");
+	LOG4CXX_INFO(logger, "dropped");
+	logger->removeAppender(appender);
+	EXPECT_EQ(1u, appender->dropped());
+
+	logger::ShmQueue::Record const* record = queue.front();
+	ASSERT_TRUE(record);
+	EXPECT_EQ("INFO  loggertests.shm first\n", std::string(record->data(), record->size));
+	queue.pop();
+	record = queue.front();
+	ASSERT_TRUE(record);
+	EXPECT_EQ("WARN  loggertests.shm second\n", std::string(record->data(), record->size));
+	queue.pop();
+	EXPECT_FALSE(queue.front());
+	EXPECT_FALSE(queue.pending());
+	EXPECT_FALSE(queue.abandoned());
+
+	logger::ShmQueue::unlink(name);
+}
+
+TEST_F(LoggerTest, TestSampling)
+{
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.sampling");
+	logger->setLevel(log4cxx::Level::getDebug());
+	log4cxx::CaptureAppenderPtr capture(new log4cxx::CaptureAppender(100));
+	logger->addAppender(capture);
+
+	for (int i = 0; i < 7; ++i) {
+		LOG4CXX_DEBUG_EVERY_N(logger, 3, "every " << i);
+		LOG4CXX_TRACE_EVERY_N(logger, 3, "disabled " << i);
+	}
+	std::vector<std::string> messages = capture->messages();
+	ASSERT_EQ(3u, messages.size());
+	EXPECT_EQ("every 0 [0 skipped]", messages[0]);
+	EXPECT_EQ("every 3 [2 skipped]", messages[1]);
+	EXPECT_EQ("every 6 [2 skipped]", messages[2]);
+
+	// the budget is exhausted within the first second
+	capture->clear();
+	for (int i = 0; i < 10000; ++i) {
+		LOG4CXX_DEBUG_PER_SECOND(logger, 5, "rate " << i);
+	}
+	logger->removeAppender(capture);
+	messages = capture->messages();
+	ASSERT_EQ(5u, messages.size());
+	EXPECT_EQ("rate 0 [0 skipped]", messages[0]);
+	EXPECT_EQ("rate 4 [0 skipped]", messages[4]);
+}
+
+TEST_F(LoggerTest, TestTiming)
+{
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.timing");
+	logger->setLevel(log4cxx::Level::getInfo());
+	log4cxx::CaptureAppenderPtr capture(new log4cxx::CaptureAppender(10));
+	logger->addAppender(capture);
+
+	visionary_logger::LatencyTimer timer(logger, "phase", std::chrono::hours(1));
+	for (int i = 0; i < 10; ++i) {
+		visionary_logger::ScopedTimer scope(timer);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	// no summary before the period elapsed
+	EXPECT_EQ(0u, capture->size());
+	timer.report();
+	ASSERT_EQ(1u, capture->size());
+	EXPECT_EQ(0u, capture->messages()[0].find("timer phase: n=10 p50="));
+
+	// summaries cover the durations since the previous one
+	EXPECT_EQ(0u, timer.summary().count);
+	std::thread([&timer] {
+		for (int i = 0; i < 3; ++i) {
+			visionary_logger::ScopedTimer scope(timer);
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}).join();
+	visionary_logger::LatencyTimer::Summary const summary = timer.summary();
+	logger->removeAppender(capture);
+	EXPECT_EQ(3u, summary.count);
+	EXPECT_GE(summary.p50_ns, 2e6);
+	EXPECT_LE(summary.p50_ns, summary.p99_ns);
+	EXPECT_LE(summary.p99_ns, summary.max_ns);
+}
+
+TEST_F(LoggerTest, TestScopedLevel)
+{
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.scoped_level");
+	logger->setLevel(log4cxx::Level::getWarn());
+	log4cxx::CaptureAppenderPtr capture(new log4cxx::CaptureAppender(10));
+	logger->addAppender(capture);
+
+	LOG4CXX_DEBUG(logger, "suppressed");
+	{
+		visionary_logger::ScopedLevel debug(log4cxx::Level::getDebug());
+		LOG4CXX_DEBUG(logger, "escalated");
+		LOG4CXX_TRACE(logger, "suppressed");
+		// other threads are not affected
+		std::thread([&logger] { LOG4CXX_DEBUG(logger, "suppressed"); }).join();
+		{
+			visionary_logger::ScopedLevel error(log4cxx::Level::getError());
+			LOG4CXX_WARN(logger, "suppressed");
+			EXPECT_FALSE(Logger::instance().willBeLogged(Logger::WARNING));
+		}
+		LOG4CXX_INFO(logger, "escalated");
+		EXPECT_TRUE(Logger::instance().willBeLogged(Logger::DEBUG0));
+	}
+	LOG4CXX_INFO(logger, "suppressed");
+	EXPECT_EQ(nullptr, visionary_logger::thread_level());
+	logger->removeAppender(capture);
+
+	std::vector<std::string> const messages = capture->messages();
+	ASSERT_EQ(2u, messages.size());
+	EXPECT_EQ("escalated", messages[0]);
+	EXPECT_EQ("escalated", messages[1]);
+}
+
+TEST_F(LoggerTest, TestReloadConfig)
+{
+	char dir[] = "/tmp/test_logger_reload_XXXXXX";
+	ASSERT_NE(nullptr, mkdtemp(dir));
+	std::string const conf = std::string(dir) + "/logger.conf";
+	auto write_conf = [&conf](std::string const& output) {
+		// replaced by renaming, as editors do
+		std::ofstream file(conf + ".new");
+		file << "log4j.logger.loggertests.reload=DEBUG, A\n"
+		     << "log4j.additivity.loggertests.reload=false\n"
+		     << "log4j.appender.A=org.apache.log4j.FileAppender\n"
+		     << "log4j.appender.A.File=" << output << "\n"
+		     << "log4j.appender.A.layout=org.apache.log4j.PatternLayout\n"
+		     << "log4j.appender.A.layout.ConversionPattern=%m%n\n";
+		file.close();
+		std::rename((conf + ".new").c_str(), conf.c_str());
+	};
+	std::string const first = std::string(dir) + "/first.log";
+	std::string const second = std::string(dir) + "/second.log";
+	write_conf(first);
+
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.reload");
+	log4cxx::ReloadableAppenderPtr appender(new log4cxx::ReloadableAppender(conf));
+	logger->addAppender(appender);
+	EXPECT_EQ(1u, appender->generation());
+	EXPECT_TRUE(logger->isDebugEnabled());
+
+	// a thread logging throughout the reload, no message may be lost
+	std::atomic<bool> stop{false};
+	size_t logged = 0;
+	std::thread background([&] {
+		while (!stop) {
+			LOG4CXX_DEBUG(logger, "message " << logged);
+			++logged;
+		}
+	});
+	write_conf(second);
+	for (int i = 0; i < 5000 && appender->generation() < 2; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(2u, appender->generation());
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	stop = true;
+	background.join();
+
+	// a configuration without appenders is refused, the current one is kept
+	std::ofstream(conf) << "log4j.logger.loggertests.reload=DEBUG\n";
+	EXPECT_THROW(appender->reload(), std::runtime_error);
+	EXPECT_EQ(2u, appender->generation());
+	logger->removeAppender(appender);
+	appender->close();
+
+	size_t lines = 0;
+	for (std::string const& output : {first, second}) {
+		std::ifstream file(output);
+		std::string line;
+		while (std::getline(file, line)) {
+			EXPECT_EQ("message " + std::to_string(lines), line);
+			++lines;
+		}
+		std::remove(output.c_str());
+	}
+	EXPECT_EQ(logged, lines);
+	std::remove(conf.c_str());
+	rmdir(dir);
+}
+
+TEST_F(LoggerTest, TestCompiledConfig)
+{
+	char dir[] = "/tmp/test_logger_compiled_XXXXXX";
+	ASSERT_NE(nullptr, mkdtemp(dir));
+	std::string const conf = std::string(dir) + "/logger.conf";
+	std::string const compiled = conf + ".bin";
+	std::string const output = std::string(dir) + "/out.log";
+	{
+		std::ofstream file(conf);
+		file << "# comment\n"
+		     << "log4j.logger.loggertests.compiled = INFO, A\n"
+		     << "log4j.additivity.loggertests.compiled=false\n"
+		     << "log4j.additivity.loggertests.kept=false\n"
+		     << "log4j.appender.A=org.apache.log4j.FileAppender\n"
+		     << "log4j.appender.A.File=" << output << "\n"
+		     << "log4j.appender.A.layout=org.apache.log4j.PatternLayout\n"
+		     << "log4j.appender.A.layout.ConversionPattern=%-5p \\\n    %m%n\n";
+	}
+	logger_compile_config(conf, compiled);
+	EXPECT_TRUE(visionary_logger::CompiledConfig::is_compiled(compiled));
+	EXPECT_FALSE(visionary_logger::CompiledConfig::is_compiled(conf));
+
+	// only named by an additivity line, keeps its appenders as with PropertyConfigurator
+	log4cxx::LoggerPtr kept = log4cxx::Logger::getLogger("loggertests.kept");
+	log4cxx::CaptureAppenderPtr capture(new log4cxx::CaptureAppender(1));
+	kept->addAppender(capture);
+
+	logger_config_from_file(compiled);
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.compiled");
+	EXPECT_FALSE(logger->getAdditivity());
+	EXPECT_FALSE(kept->getAdditivity());
+	EXPECT_EQ(1u, kept->getAllAppenders().size());
+	kept->removeAllAppenders();
+	kept->setAdditivity(true);
+	LOG4CXX_DEBUG(logger, "suppressed");
+	LOG4CXX_INFO(logger, "compiled");
+	logger->removeAllAppenders();
+
+	std::ifstream file(output);
+	std::string line;
+	std::getline(file, line);
+	EXPECT_EQ("INFO  compiled", line);
+	EXPECT_FALSE(std::getline(file, line));
+
+	{
+		std::ofstream unsupported(conf);
+		unsupported << "log4j.appender.A=org.apache.log4j.net.SyslogAppender\n";
+	}
+	EXPECT_THROW(logger_compile_config(conf, compiled), std::runtime_error);
+
+	std::remove(output.c_str());
+	std::remove(compiled.c_str());
+	std::remove(conf.c_str());
+	rmdir(dir);
+}
+
+TEST_F(LoggerTest, TestAppenderSnapshot)
+{
+	log4cxx::LoggerPtr parent = log4cxx::Logger::getLogger("loggertests.snapshot");
+	log4cxx::LoggerPtr child = log4cxx::Logger::getLogger("loggertests.snapshot.child");
+	log4cxx::CaptureAppenderPtr capture(new log4cxx::CaptureAppender(10));
+	parent->addAppender(capture);
+
+	EXPECT_FALSE(visionary_logger::has_appenders(child));
+	EXPECT_TRUE(visionary_logger::reaches_appenders(child));
+	visionary_logger::AppenderChainPtr const chain = visionary_logger::appender_chain(child);
+	EXPECT_EQ(0u, chain->own);
+	ASSERT_EQ(1u, chain->appenders.size());
+	EXPECT_EQ(capture, chain->appenders[0]);
+	// shared until the configuration changes
+	EXPECT_EQ(chain, visionary_logger::appender_chain(child));
+
+	// reported by log4cxx
+	child->addAppender(capture);
+	EXPECT_TRUE(visionary_logger::has_appenders(child));
+	EXPECT_NE(chain, visionary_logger::appender_chain(child));
+	std::thread([&child] {
+		EXPECT_EQ(2u, visionary_logger::appender_chain(child)->appenders.size());
+	}).join();
+
+	child->setAdditivity(false);
+	child->removeAllAppenders();
+	visionary_logger::appenders_changed();
+	EXPECT_FALSE(visionary_logger::has_appenders(child));
+	EXPECT_FALSE(visionary_logger::reaches_appenders(child));
+	parent->removeAppender(capture);
+	child->setAdditivity(true);
+	visionary_logger::appenders_changed();
+
+	// threads do not keep removed appenders alive
+	log4cxx::AppenderPtr removed(new log4cxx::CaptureAppender(1));
+	std::weak_ptr<log4cxx::Appender> const weak = removed;
+	parent->addAppender(removed);
+	EXPECT_TRUE(visionary_logger::reaches_appenders(child));
+	parent->removeAppender(removed);
+	visionary_logger::appenders_changed();
+	removed.reset();
+	// the next snapshot of any thread drops the previous generation
+	std::thread([&child] {
+		EXPECT_FALSE(visionary_logger::has_appenders(child));
+	}).join();
+	EXPECT_TRUE(weak.expired());
+}
+
+TEST_F(LoggerTest, TestDefaultLoggerAfterReset)
+{
+	log4cxx::LoggerPtr logger =
+	    get_default_logger("loggertests.reset", log4cxx::Level::getInfo(), std::string(), false);
+	EXPECT_TRUE(visionary_logger::has_appenders(logger));
+
+	// not reported by log4cxx, the logger is configured again
+	log4cxx::BasicConfigurator::resetConfiguration();
+	EXPECT_FALSE(visionary_logger::has_appenders(logger));
+	logger =
+	    get_default_logger("loggertests.reset", log4cxx::Level::getInfo(), std::string(), false);
+	EXPECT_TRUE(visionary_logger::has_appenders(logger));
+	EXPECT_EQ(1u, logger->getAllAppenders().size());
+
+	logger->removeAllAppenders();
+	EXPECT_FALSE(visionary_logger::has_appenders(logger));
+}
+
+TEST_F(LoggerTest, TestConsoleLayout)
+{
+	log4cxx::spi::LoggingEventPtr event(new log4cxx::spi::LoggingEvent(
+	    "loggertests.console", log4cxx::Level::getWarn(), "layout", LOG4CXX_LOCATION));
+	log4cxx::helpers::Pool pool;
+	log4cxx::LogString colored;
+	log4cxx::ConsoleLayout().format(colored, event, pool);
+	EXPECT_TRUE(std::regex_match(
+	    colored, std::regex("\x1B\\[33mWARN \x1B\\[0m \\d\\d:\\d\\d:\\d\\d,\\d{3}  "
+	                        "loggertests\\.console layout\n")))
+	    << colored;
+
+	// as PatternLayout("%-5p %d{HH:mm:ss,SSS}  %c %m%n")
+	log4cxx::LogString plain;
+	log4cxx::ConsoleLayout(false).format(plain, event, pool);
+	log4cxx::LogString expected;
+	log4cxx::PatternLayout("%-5p %d{HH:mm:ss,SSS}  %c %m%n").format(expected, event, pool);
+	EXPECT_EQ(expected, plain);
+}
+
+TEST_F(LoggerTest, TestFanOut)
+{
+	char fname[] = "/tmp/test_logger_fanout_XXXXXX";
+	::close(mkstemp(fname));
+	FILE* console = tmpfile();
+	FILE* buffered = tmpfile();
+	ASSERT_NE(nullptr, console);
+	ASSERT_NE(nullptr, buffered);
+
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.fanout");
+	log4cxx::FanOutAppenderPtr fanout(new log4cxx::FanOutAppender);
+	fanout->add_console(true, log4cxx::FanOutAppender::DateFormat::absolute, false, console);
+	fanout->add_console(
+	    false, log4cxx::FanOutAppender::DateFormat::none, false, buffered, true);
+	fanout->add_file(fname, false, log4cxx::FanOutAppender::DateFormat::iso8601, true);
+	logger->addAppender(fanout);
+	LOG4CXX_INFO(logger, "fan out");
+	// flushed after every event unless buffered until an error or close()
+	EXPECT_NE(0, lseek(fileno(console), 0, SEEK_END));
+	EXPECT_EQ(0, lseek(fileno(buffered), 0, SEEK_END));
+	logger->removeAppender(fanout);
+	fanout->close();
+	EXPECT_NE(0, lseek(fileno(buffered), 0, SEEK_END));
+	fclose(buffered);
+
+	char buffer[256] = {};
+	rewind(console);
+	ASSERT_NE(nullptr, fgets(buffer, sizeof(buffer), console));
+	fclose(console);
+	EXPECT_TRUE(std::regex_match(
+	    buffer, std::regex("\x1B\\[32mINFO \x1B\\[0m \\d\\d:\\d\\d:\\d\\d,\\d{3}  "
+	                       "loggertests\\.fanout fan out\n")))
+	    << buffer;
+
+	std::ifstream file(fname);
+	std::string line;
+	std::getline(file, line);
+	EXPECT_TRUE(std::regex_match(
+	    line, std::regex("INFO  \\d{4}-\\d\\d-\\d\\d \\d\\d:\\d\\d:\\d\\d,\\d{3}  "
+	                     "loggertests\\.fanout fan out")))
+	    << line;
+	std::getline(file, line);
+	EXPECT_EQ(0u, line.find("  ->  "));
+	EXPECT_NE(std::string::npos, line.find("test_logger.cpp:"));
+	std::remove(fname);
+}
+
+TEST_F(LoggerTest, TestAsyncFile)
+{
+	using Backend = logger::AsyncFile::Backend;
+	for (Backend backend : {Backend::automatic, Backend::pwrite}) {
+		char fname[] = "/tmp/test_logger_async_XXXXXX";
+		::close(mkstemp(fname));
+
+		log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.async");
+		log4cxx::AsyncFileAppenderPtr appender(new log4cxx::AsyncFileAppender(
+		    log4cxx::LayoutPtr(new log4cxx::PatternLayout("%m\n")), fname, false, backend));
+		EXPECT_NE(Backend::automatic, appender->file().backend());
+		logger->addAppender(appender);
+		// fits into the buffers, nothing is dropped
+		for (size_t i = 0; i < 1000; ++i) {
+			LOG4CXX_INFO(logger, std::to_string(i));
+		}
+		appender->flush();
+		logger->removeAppender(appender);
+		appender->close();
+		EXPECT_EQ(0u, appender->file().dropped());
+		EXPECT_EQ(0, appender->file().error());
+
+		std::ifstream file(fname);
+		std::string line;
+		size_t expected = 0;
+		while (std::getline(file, line)) {
+			EXPECT_EQ(std::to_string(expected), line);
+			++expected;
+		}
+		EXPECT_EQ(1000u, expected);
+		std::remove(fname);
+	}
+
+	// records written after close are never in the file, they count as dropped
+	char fname[] = "/tmp/test_logger_async_XXXXXX";
+	::close(mkstemp(fname));
+	logger::AsyncFile file(fname, false, Backend::automatic);
+	EXPECT_TRUE(file.write("early\n", 6));
+	file.close();
+	EXPECT_FALSE(file.write("late\n", 5));
+	EXPECT_EQ(1u, file.dropped());
+	std::ifstream in(fname);
+	std::string line;
+	EXPECT_TRUE(std::getline(in, line));
+	EXPECT_EQ("early", line);
+	EXPECT_FALSE(std::getline(in, line));
+	std::remove(fname);
+}
+
+TEST_F(LoggerTest, TestConsoleColors)
+{
+	if (!isatty(STDOUT_FILENO)) {
+		EXPECT_FALSE(logger_console_colors());
+	}
+
+	FILE* colored = tmpfile();
+	FILE* plain = tmpfile();
+	ASSERT_NE(nullptr, colored);
+	ASSERT_NE(nullptr, plain);
+	log4cxx::LoggerPtr logger = log4cxx::Logger::getLogger("loggertests.colors");
+	log4cxx::FanOutAppenderPtr fanout(new log4cxx::FanOutAppender);
+	fanout->add_console(true, log4cxx::FanOutAppender::DateFormat::none, false, colored);
+	fanout->add_console(false, log4cxx::FanOutAppender::DateFormat::none, false, plain);
+	logger->addAppender(fanout);
+	// buffered output of the stream precedes the event
+	fputs("before\n", plain);
+	LOG4CXX_WARN(logger, "warning");
+	logger->removeAppender(fanout);
+
+	auto const read_line = [](FILE* stream) {
+		char buffer[256];
+		return std::string(fgets(buffer, sizeof(buffer), stream) ? buffer : "");
+	};
+	rewind(colored);
+	EXPECT_EQ("\x1B[33mWARN \x1B[0m  loggertests.colors warning\n", read_line(colored));
+	rewind(plain);
+	EXPECT_EQ("before\n", read_line(plain));
+	EXPECT_EQ("WARN   loggertests.colors warning\n", read_line(plain));
+	fclose(colored);
+	fclose(plain);
+}
+
+TEST_F(LoggerTest, TestDefaultConfigFanOut)
+{
+	char fname[] = "/tmp/test_logger_default_XXXXXX";
+	::close(mkstemp(fname));
+
+	log4cxx::LoggerPtr root = log4cxx::Logger::getRootLogger();
+	// opt-in, by default console and file keep their appenders
+	logger_default_config(log4cxx::Level::getInfo(), fname, true);
+	EXPECT_TRUE(root->getAppender("COUT"));
+	EXPECT_TRUE(root->getAppender("FILE"));
+	logger_reset();
+	logger_default_config(
+	    log4cxx::Level::getInfo(), fname, false, false, false, "RELATIVE", false, false, true);
+	EXPECT_TRUE(root->getAppender("FILE"));
+	logger_default_config(
+	    log4cxx::Level::getInfo(), fname, false, false, false, "ISO8601", false, false, true);
+	logger_default_config(
+	    log4cxx::Level::getInfo(), fname, false, false, false, "ISO8601", false, false, true);
+	// one appender for all outputs, replacing "FILE" and previous calls
+	EXPECT_EQ(1u, root->getAllAppenders().size());
+	EXPECT_TRUE(root->getAppender("FANOUT"));
+	EXPECT_FALSE(root->getAppender("FILE"));
+	logger_reset();
+	std::remove(fname);
+}
@@ -0,0 +1,350 @@
+#include <gtest/gtest.h>
+
+extern "C" {
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LOGGER_SYSLOG_NATIVE
+// DEBUG is compiled in, but disabled at runtime
+#define SYSLOG_THRESHOLD LogPriority::DEBUG
+#define SYSLOG_RUNTIME_THRESHOLD LogPriority::INFO
+#include "logger/syslog/logger.h"
+
+/**
+ * Unix datagram socket standing in for the syslog daemon.
+ */
+class SyslogListener
+{
+public:
+	SyslogListener(std::string const& path) : m_path(path), m_fd(-1)
+	{
+		bind();
+	}
+
+	~SyslogListener()
+	{
+		close();
+	}
+
+	void bind()
+	{
+		::unlink(m_path.c_str());
+		m_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+		struct sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		std::strncpy(addr.sun_path, m_path.c_str(), sizeof(addr.sun_path) - 1);
+		ASSERT_EQ(0, ::bind(m_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)));
+		struct timeval timeout = {1, 0};
+		setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	}
+
+	void close()
+	{
+		if (m_fd >= 0) {
+			::close(m_fd);
+			::unlink(m_path.c_str());
+			m_fd = -1;
+		}
+	}
+
+	/// next record, empty on timeout
+	std::string receive()
+	{
+		char buffer[65536];
+		ssize_t const size = recv(m_fd, buffer, sizeof(buffer), 0);
+		return (size < 0) ? std::string() : std::string(buffer, size);
+	}
+
+	std::string const& path() const
+	{
+		return m_path;
+	}
+
+private:
+	std::string m_path;
+	int m_fd;
+};
+
+class SyslogTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		char dir[] = "/tmp/test_syslog_XXXXXX";
+		ASSERT_NE(nullptr, mkdtemp(dir));
+		m_dir = dir;
+		m_listener.reset(new SyslogListener(m_dir + "/log"));
+		logger::syslog_open("test_syslog", LOG_CONS, LOG_USER, m_listener->path().c_str());
+	}
+
+	virtual void TearDown()
+	{
+		logger::syslog_close();
+		m_listener.reset();
+		::rmdir(m_dir.c_str());
+	}
+
+	std::string m_dir;
+	std::unique_ptr<SyslogListener> m_listener;
+};
+
+TEST_F(SyslogTest, RFC5424Record)
+{
+	LOGGER_SYSLOG(INFO, "hello " << 42 << " 100%s");
+	std::string const record = m_listener->receive();
+
+	// <PRI>1 TIMESTAMP HOSTNAME APP-NAME PROCID MSGID SD MSG
+	EXPECT_EQ(0u, record.find("<14>1 ")) << record;
+	EXPECT_NE(std::string::npos, record.find("Z ")) << record;
+	EXPECT_NE(
+	    std::string::npos,
+	    record.find(" test_syslog " + std::to_string(getpid()) + " - [" LOGGER_FIELDS_SD_ID " uid="))
+	    << record;
+	EXPECT_NE(std::string::npos, record.find("\"] [INFO] hello 42 100%s")) << record;
+	EXPECT_EQ(record.size() - std::strlen("[INFO] hello 42 100%s"), record.find("[INFO]"));
+}
+
+TEST_F(SyslogTest, Threshold)
+{
+	LOGGER_SYSLOG(DEBUG, "not sent");
+	LOGGER_SYSLOG(ERROR, "sent");
+	std::string const record = m_listener->receive();
+	EXPECT_EQ(0u, record.find("<11>1 ")) << record;
+	EXPECT_NE(std::string::npos, record.find("[ERROR] sent")) << record;
+}
+
+TEST_F(SyslogTest, Truncation)
+{
+	std::string const message(2 * LOGGER_SYSLOG_BUFFER_SIZE, 'x');
+	LOGGER_SYSLOG(WARN, message);
+	std::string const record = m_listener->receive();
+	std::string const expected =
+	    "[WARN] " + message.substr(0, LOGGER_SYSLOG_BUFFER_SIZE - std::strlen("[WARN] "));
+	ASSERT_GE(record.size(), expected.size());
+	EXPECT_EQ(expected, record.substr(record.size() - expected.size()));
+}
+
+TEST_F(SyslogTest, Reconnect)
+{
+	LOGGER_SYSLOG(INFO, "first");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("first"));
+
+	// syslog daemon restarts
+	m_listener->close();
+	LOGGER_SYSLOG(INFO, "lost");
+	m_listener->bind();
+
+	LOGGER_SYSLOG(INFO, "second");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("second"));
+}
+
+TEST_F(SyslogTest, OpenSyslogClose)
+{
+	LOGGER_OPEN_SYSLOG_CLOSE(WARN, "test_syslog", "one shot");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("[WARN] one shot"));
+
+	// the native client keeps its connection instead of reconnecting for every message
+	bool connected = false;
+	for (int fd = 0; fd < 1024 && !connected; ++fd) {
+		sockaddr_un peer;
+		socklen_t size = sizeof(peer);
+		connected = getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &size) == 0 &&
+		            peer.sun_family == AF_UNIX && m_listener->path() == peer.sun_path;
+	}
+	EXPECT_TRUE(connected);
+}
+
+TEST_F(SyslogTest, CloseKeepsDescriptor)
+{
+	auto const open_descriptors = [] {
+		size_t count = 0;
+		if (DIR* dir = opendir("/proc/self/fd")) {
+			while (readdir(dir)) {
+				++count;
+			}
+			closedir(dir);
+		}
+		return count;
+	};
+
+	LOGGER_SYSLOG(INFO, "first");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("first"));
+	size_t const connected = open_descriptors();
+
+	// concurrent senders may still hold the descriptor, it must not be reused by others
+	logger::syslog_close();
+	EXPECT_EQ(connected, open_descriptors());
+
+	LOGGER_SYSLOG(INFO, "reconnected");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("reconnected"));
+	EXPECT_EQ(connected, open_descriptors());
+}
+
+TEST_F(SyslogTest, Async)
+{
+	logger::syslog_start_async(8);
+	EXPECT_TRUE(logger::syslog_async_enabled());
+	for (int i = 0; i < 5; ++i) {
+		LOGGER_SYSLOG(INFO, "async " << i);
+	}
+	logger::syslog_stop_async();
+	EXPECT_FALSE(logger::syslog_async_enabled());
+
+	for (int i = 0; i < 5; ++i) {
+		std::string const record = m_listener->receive();
+		EXPECT_NE(std::string::npos, record.find("[INFO] async " + std::to_string(i))) << record;
+	}
+}
+
+TEST_F(SyslogTest, AsyncStopWhileLogging)
+{
+	size_t const dropped_before = logger::syslog_dropped();
+	size_t received = 0;
+	std::thread reader([&] {
+		while (!m_listener->receive().empty()) {
+			++received;
+		}
+	});
+
+	size_t const threads = 4;
+	size_t const messages = 500;
+	logger::syslog_start_async(4096);
+	std::vector<std::thread> producers;
+	for (size_t t = 0; t < threads; ++t) {
+		producers.emplace_back([] {
+			for (size_t i = 0; i < messages; ++i) {
+				LOGGER_SYSLOG(INFO, "racing " << i);
+			}
+		});
+	}
+	// no record is stranded in the queue by producers racing with the stop
+	logger::syslog_stop_async();
+	for (auto& producer : producers) {
+		producer.join();
+	}
+	reader.join();
+	EXPECT_EQ(threads * messages, received + (logger::syslog_dropped() - dropped_before));
+}
+
+TEST_F(SyslogTest, AsyncDropped)
+{
+	size_t const dropped_before = logger::syslog_dropped();
+	logger::syslog_start_async(8);
+	// never blocks, even though nobody reads from the socket
+	for (int i = 0; i < 1000; ++i) {
+		LOGGER_SYSLOG(INFO, "flood " << i);
+	}
+	EXPECT_LT(dropped_before, logger::syslog_dropped());
+
+	bool reported = false;
+	for (std::string record = m_listener->receive(); !record.empty();
+	     record = m_listener->receive()) {
+		reported = reported || (record.find("[WARN] syslog sender dropped") != std::string::npos);
+	}
+	logger::syslog_stop_async();
+	EXPECT_TRUE(reported);
+}
+
+TEST_F(SyslogTest, Fields)
+{
+	LOGGER_SYSLOG_FIELDS(
+	    INFO, logger::fields("run", 3, "ratio", 0.5, "name", "a\"b]", "bad key", true), "fields");
+	std::string const record = m_listener->receive();
+	EXPECT_NE(std::string::npos, record.find(" pid=\"" + std::to_string(getpid()) + "\" hostname=\""))
+	    << record;
+	EXPECT_NE(
+	    std::string::npos,
+	    record.find(R"( run="3" ratio="0.5" name="a\"b\]" bad_key="true"] [INFO] fields)"))
+	    << record;
+}
+
+TEST_F(SyslogTest, StaticFields)
+{
+	logger::set_static_field("experiment", "calib");
+	LOGGER_SYSLOG(INFO, "static");
+	std::string const record = m_listener->receive();
+	logger::StaticFields::instance().remove("experiment");
+	EXPECT_NE(std::string::npos, record.find(" experiment=\"calib\"] [INFO] static")) << record;
+
+	LOGGER_SYSLOG(INFO, "removed");
+	EXPECT_EQ(std::string::npos, m_listener->receive().find("experiment"));
+}
+
+TEST_F(SyslogTest, FieldsTruncation)
+{
+	std::string const large(4096, 'x');
+	LOGGER_SYSLOG_FIELDS(INFO, logger::fields("small", 1, "large", large), "truncated");
+	std::string const record = m_listener->receive();
+	// incomplete parameters are dropped, the element stays well-formed
+	EXPECT_NE(std::string::npos, record.find(" small=\"1\"] [INFO] truncated")) << record;
+	EXPECT_EQ(std::string::npos, record.find("large")) << record;
+}
+
+TEST_F(SyslogTest, RuntimeThreshold)
+{
+	EXPECT_EQ(logger::LogPriority::INFO, logger::syslog_threshold());
+
+	logger::syslog_set_threshold(logger::LogPriority::DEBUG);
+	LOGGER_SYSLOG(DEBUG, "enabled");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("[DEBUG] enabled"));
+
+	logger::syslog_set_threshold(logger::LogPriority::ERROR);
+	bool streamed = false;
+	LOGGER_SYSLOG(WARN, "disabled" << (streamed = true));
+	EXPECT_FALSE(streamed);
+	LOGGER_SYSLOG(ERROR, "sent");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("[ERROR] sent"));
+
+	logger::syslog_set_threshold(logger::LogPriority::INFO);
+}
+
+TEST_F(SyslogTest, RuntimeThresholdOpen)
+{
+	// applied by the first call only, later ones keep the threshold set at runtime
+	EXPECT_EQ(logger::LogPriority::INFO, logger::syslog_threshold());
+	logger::syslog_open("test_syslog", LOG_CONS, LOG_USER, nullptr, logger::LogPriority::ERROR);
+	EXPECT_EQ(logger::LogPriority::INFO, logger::syslog_threshold());
+}
+
+TEST_F(SyslogTest, RuntimeThresholdEnvironment)
+{
+	// as if no syslog_open() happened yet
+	logger::detail::syslog_threshold_configured.store(false);
+	setenv("LOGGER_SYSLOG_THRESHOLD", "debug", 1);
+	logger::syslog_open("test_syslog", LOG_CONS, LOG_USER);
+	EXPECT_EQ(logger::LogPriority::DEBUG, logger::syslog_threshold());
+
+	// read by the first call only, a threshold set at runtime is kept
+	logger::syslog_set_threshold(logger::LogPriority::ERROR);
+	logger::syslog_open("test_syslog", LOG_CONS, LOG_USER);
+	EXPECT_EQ(logger::LogPriority::ERROR, logger::syslog_threshold());
+
+	logger::detail::syslog_threshold_configured.store(false);
+	setenv("LOGGER_SYSLOG_THRESHOLD", "unknown", 1);
+	logger::syslog_open("test_syslog", LOG_CONS, LOG_USER);
+	unsetenv("LOGGER_SYSLOG_THRESHOLD");
+	EXPECT_EQ(logger::LogPriority::INFO, logger::syslog_threshold());
+}
+
+TEST_F(SyslogTest, RuntimeThresholdSignal)
+{
+	logger::syslog_threshold_signal(SIGUSR2);
+	raise(SIGUSR2);
+	EXPECT_EQ(logger::LogPriority::DEBUG, logger::syslog_threshold());
+	LOGGER_SYSLOG(DEBUG, "toggled");
+	EXPECT_NE(std::string::npos, m_listener->receive().find("[DEBUG] toggled"));
+
+	raise(SIGUSR2);
+	EXPECT_EQ(logger::LogPriority::INFO, logger::syslog_threshold());
+	signal(SIGUSR2, SIG_DFL);
+}
@@ -0,0 +1,181 @@
+/**
+ * Collector merging the log output of all processes attached to a shared-memory queue (cf.
+ * logger/shm_queue.h and log4cxx::SharedMemoryAppender) into a single file.
+ *
+ * Usage: vislog_collector [-n name] [-c capacity] [-r record_size] [-a] [-k] [-o file]
+ *   -n  segment name, defaults to logger::shm_default_name()
+ *   -c  number of queued records if the segment is created (4096)
+ *   -r  maximum record size if the segment is created (4096)
+ *   -o  output file, defaults to stdout
+ *   -a  append to the output file
+ *   -k  keep the segment on exit, e.g. for a subsequent collector
+ *
+ * Terminates on SIGINT or SIGTERM after writing all queued records.
+ */
+
+extern "C" {
+#include <signal.h>
+#include <unistd.h>
+}
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "logger/shm_queue.h"
+
+namespace {
+
+volatile std::sig_atomic_t stop = 0;
+
+void handle_signal(int)
+{
+	stop = 1;
+}
+
+/// report slots claimed by a producer that did not finish writing them within this time
+auto const pending_timeout = std::chrono::seconds(5);
+
+void usage(char const* program)
+{
+	fprintf(
+	    stderr, "usage: %s [-n name] [-c capacity] [-r record_size] [-a] [-k] [-o file]\n",
+	    program);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	std::string name = logger::shm_default_name();
+	size_t capacity = 4096;
+	size_t record_size = 4096;
+	char const* output = nullptr;
+	bool append = false;
+	bool keep = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "n:c:r:o:akh")) != -1) {
+		switch (opt) {
+			case 'n':
+				name = optarg;
+				break;
+			case 'c':
+				capacity = std::strtoul(optarg, nullptr, 10);
+				break;
+			case 'r':
+				record_size = std::strtoul(optarg, nullptr, 10);
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			case 'a':
+				append = true;
+				break;
+			case 'k':
+				keep = true;
+				break;
+			default:
+				usage(argv[0]);
+				return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind != argc || capacity == 0 || record_size == 0) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	FILE* out = stdout;
+	if (output) {
+		out = fopen(output, append ? "a" : "w");
+		if (!out) {
+			perror(output);
+			return EXIT_FAILURE;
+		}
+	}
+	// flushed whenever the queue runs empty
+	static char buffer[1 << 20];
+	setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+	struct sigaction action = {};
+	action.sa_handler = handle_signal;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+
+	try {
+		logger::ShmQueue queue(name, capacity, record_size);
+		uint64_t reported_dropped = queue.dropped();
+		auto pending_since = std::chrono::steady_clock::time_point::max();
+		bool reported_pending = false;
+		unsigned idle = 0;
+
+		while (true) {
+			if (logger::ShmQueue::Record const* record = queue.front()) {
+				fwrite(record->data(), 1, record->size, out);
+				if (record->flags & logger::ShmQueue::truncated) {
+					fputs(" [truncated]\n", out);
+				}
+				queue.pop();
+				idle = 0;
+				pending_since = std::chrono::steady_clock::time_point::max();
+				continue;
+			}
+
+			uint64_t const dropped = queue.dropped();
+			if (dropped != reported_dropped) {
+				fprintf(
+				    out, "WARN  vislog_collector: dropped %lu records, queue full\n",
+				    static_cast<unsigned long>(dropped - reported_dropped));
+				reported_dropped = dropped;
+			}
+
+			if (queue.pending()) {
+				auto const now = std::chrono::steady_clock::now();
+				if (pending_since == std::chrono::steady_clock::time_point::max()) {
+					pending_since = now;
+					reported_pending = false;
+				} else if (queue.abandoned()) {
+					// the producer died while writing, it never finishes the record
+					fputs("WARN  vislog_collector: skipped unfinished record\n", out);
+					queue.pop();
+					pending_since = std::chrono::steady_clock::time_point::max();
+				} else if (!reported_pending && now - pending_since > pending_timeout) {
+					// e.g. stopped by SIGSTOP, skipping would let it overwrite a later record
+					fputs("WARN  vislog_collector: waiting for a stalled producer\n", out);
+					reported_pending = true;
+				}
+			}
+			if (stop && (!queue.pending() ||
+			             std::chrono::steady_clock::now() - pending_since > pending_timeout)) {
+				// gives up on a stalled producer only when terminating
+				break;
+			}
+
+			if (idle == 0) {
+				fflush(out);
+			}
+			// spin shortly for bursts, then poll at 1 kHz
+			if (++idle < 64) {
+				std::this_thread::yield();
+			} else {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+	} catch (std::system_error const& error) {
+		fprintf(stderr, "vislog_collector: %s\n", error.what());
+		return EXIT_FAILURE;
+	}
+
+	if (!keep) {
+		logger::ShmQueue::unlink(name);
+	}
+	fflush(out);
+	if (out != stdout) {
+		fclose(out);
+	}
+	return EXIT_SUCCESS;
+}